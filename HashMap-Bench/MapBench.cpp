@@ -0,0 +1,565 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "logger.hpp"
+#include "hashmap.hpp"
+
+/* Name of the map variant this binary is built against; see makefile */
+#ifndef MAP_VARIANT
+#define MAP_VARIANT "unknown"
+#endif
+
+/* 1 for variants whose map takes stripes and optimistic reads (HashMap-TS-New) */
+#ifndef MAP_HAS_STRIPES
+#define MAP_HAS_STRIPES 0
+#endif
+
+
+namespace HashMapTest {
+
+using std::vector;
+using std::thread;
+using std::setw;
+using std::fixed;
+using std::setprecision;
+using std::mt19937_64;
+using std::chrono::steady_clock;
+using std::chrono::duration;
+using std::chrono::nanoseconds;
+using std::chrono::duration_cast;
+
+/* typedef for BenchKey */
+typedef uint64_t BenchKey;
+
+/* typedef for the benchmarked map */
+typedef TSHashMap< BenchKey, BenchKey > BenchMap;
+
+/* Benchmark Default Configurations */
+enum BenchDefaults
+{
+    KEY_SPACE       = 1 << 20,
+    LOCK_STRIPES    = 16,
+    DURATION_MS     = 1000,
+    READ_PERCENT    = 80,
+    WRITE_PERCENT   = 15,
+    DELETE_PERCENT  = 5,
+    PREFILL_PERCENT = 50,
+    RANDOM_SEED     = 42
+};
+
+const double DEFAULT_ZIPF_THETA = 0.99;     // as YCSB
+
+const unsigned int LATENCY_SUB_BITS    = 4;
+const unsigned int LATENCY_SUB_BUCKETS = 1 << LATENCY_SUB_BITS;
+const unsigned int LATENCY_BUCKETS     = ( 64 - LATENCY_SUB_BITS + 1 ) * LATENCY_SUB_BUCKETS;
+
+enum class Distribution { UNIFORM, ZIPF, SEQUENTIAL };
+
+enum class Op : unsigned int { FIND, ADD, DEL };
+
+struct BenchConfig
+{
+    vector< size_t >    threads;        // one run per count
+    unsigned int        readPercent;
+    unsigned int        writePercent;
+    unsigned int        deletePercent;
+    Distribution        distribution;
+    double              theta;          // zipf skew
+    size_t              keySpace;
+    size_t              mapSize;        // initial map size; 0 for the key space
+    unsigned int        prefillPercent; // of the key space, added before a run
+    size_t              durationMs;     // run length, unless ops is set
+    size_t              ops;            // ops per thread; 0 for a timed run
+    size_t              sampleEvery;    // time every Nth op
+    uint64_t            seed;
+    bool                isCsv;
+    size_t              stripes;        // lock stripes, with MAP_HAS_STRIPES
+    bool                isOptimistic;   // optimistic reads, with MAP_HAS_STRIPES
+};
+
+/*
+ * Latencies in ns; log-linear buckets as in HashMap-TS-New's op stats, so
+ * percentiles are off by at most 1 / LATENCY_SUB_BUCKETS (6.25%). Kept
+ * here as the older variants don't have op stats.
+ */
+struct LatencyHistogram
+{
+    uint64_t    counts[ LATENCY_BUCKETS ];
+    uint64_t    count;
+    uint64_t    max;
+
+    void record( const uint64_t value )
+    {
+        counts[ bucketOf( value ) ]++;
+        count++;
+        max = std::max( max, value );
+    }
+
+    uint64_t percentile( const double quantile ) const
+    {
+        if ( count == 0 ) return 0;
+
+        const uint64_t rank = std::max< uint64_t >( 1, (uint64_t) ( quantile * count + 0.5 ) );
+        uint64_t       seen = 0;
+
+        for ( size_t bucket = 0; bucket < LATENCY_BUCKETS; ++bucket )
+        {
+            seen += counts[ bucket ];
+            if ( seen >= rank ) return std::min( highestOf( bucket ), max );
+        }
+
+        return max;
+    }
+
+    LatencyHistogram& operator+=( const LatencyHistogram& other )
+    {
+        for ( size_t bucket = 0; bucket < LATENCY_BUCKETS; ++bucket ) counts[ bucket ] += other.counts[ bucket ];
+
+        count += other.count;
+        max    = std::max( max, other.max );
+
+        return *this;
+    }
+
+    static size_t bucketOf( const uint64_t value )
+    {
+        if ( value < LATENCY_SUB_BUCKETS ) return (size_t) value;
+
+        const unsigned int shift = 63 - __builtin_clzll( value ) - LATENCY_SUB_BITS;
+
+        return ( shift + 1 ) * LATENCY_SUB_BUCKETS + (size_t) ( ( value >> shift ) & ( LATENCY_SUB_BUCKETS - 1 ) );
+    }
+
+    static uint64_t highestOf( const size_t bucket )
+    {
+        if ( bucket < LATENCY_SUB_BUCKETS ) return bucket;
+
+        const unsigned int shift  = bucket / LATENCY_SUB_BUCKETS - 1;
+        const uint64_t     lowest = ( (uint64_t) LATENCY_SUB_BUCKETS + bucket % LATENCY_SUB_BUCKETS ) << shift;
+
+        return lowest + ( ( (uint64_t) 1 << shift ) - 1 );
+    }
+};
+
+/* What one thread did in a run */
+struct ThreadResult
+{
+    LatencyHistogram    latencies;
+    uint64_t            ops;
+    uint64_t            finds;
+    uint64_t            hits;
+    uint64_t            checksum;   // of the ops and keys generated
+};
+
+/* Function Prototypes */
+uint64_t mix64( uint64_t value );
+
+bool parseConfig( int argc, char* argv[], BenchConfig& config );
+
+void runBenchmark( const BenchConfig& config, const size_t nThreads, const double zetaN, ostream& out );
+
+void mapBenchmark( const BenchConfig& config, ostream& out );
+
+/* Function Definitions */
+
+/* SplitMix64 finalizer; spreads ranks and seeds */
+uint64_t mix64( uint64_t value )
+{
+    value += 0x9e3779b97f4a7c15ULL;
+    value  = ( value ^ ( value >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+    value  = ( value ^ ( value >> 27 ) ) * 0x94d049bb133111ebULL;
+
+    return value ^ ( value >> 31 );
+}
+
+/*
+ * Keys of one thread. Only mt19937_64's output is used, never a standard
+ * distribution, since the engine's sequence is fixed by the standard but
+ * distributions differ between library versions; the same seed gives the
+ * same keys with any compiler.
+ *
+ * ZIPF is the generator of Gray et al. as used by YCSB, with its ranks
+ * scrambled over the key space so hot keys don't share buckets. SEQUENTIAL
+ * walks the key space from a different start in every thread.
+ */
+class KeyGenerator
+{
+public:
+    KeyGenerator( const BenchConfig& config, const size_t thread, const size_t nThreads, const double zetaN ) :
+        _random{ mix64( config.seed ^ mix64( thread + 1 ) ) }, _distribution{ config.distribution },
+        _keySpace{ config.keySpace }, _next{ config.keySpace / nThreads * thread },
+        _theta{ config.theta }, _zetaN{ zetaN }, _alpha{ 0 }, _eta{ 0 }
+    {
+        if ( _distribution == Distribution::ZIPF )
+        {
+            const double zeta2 = 1 + std::pow( 0.5, _theta );
+
+            _alpha = 1 / ( 1 - _theta );
+            _eta   = ( 1 - std::pow( 2.0 / _keySpace, 1 - _theta ) ) / ( 1 - zeta2 / _zetaN );
+        }
+    }
+
+    /* Uniform in [0, bound) */
+    uint64_t below( const uint64_t bound )
+    {
+        return (uint64_t) ( ( (unsigned __int128) _random() * bound ) >> 64 );
+    }
+
+    BenchKey next( void )
+    {
+        switch ( _distribution )
+        {
+            case Distribution::UNIFORM:
+                return below( _keySpace );
+
+            case Distribution::SEQUENTIAL:
+            {
+                const BenchKey key = _next;
+                _next = ( _next + 1 == _keySpace ) ? 0 : _next + 1;
+                return key;
+            }
+
+            case Distribution::ZIPF:
+                return mix64( zipfRank() ) % _keySpace;
+        }
+
+        return 0;
+    }
+
+    /* Sum of 1 / i^theta over the key space; shared by all threads of a run */
+    static double zeta( const size_t n, const double theta )
+    {
+        double sum = 0;
+        for ( size_t i = 1; i <= n; ++i ) sum += 1 / std::pow( (double) i, theta );
+        return sum;
+    }
+
+private:
+    uint64_t zipfRank( void )
+    {
+        const double u  = ( _random() >> 11 ) / 9007199254740992.0;    // [0, 1), 53 bits
+        const double uz = u * _zetaN;
+
+        if ( uz < 1 ) return 0;
+        if ( uz < 1 + std::pow( 0.5, _theta ) ) return 1;
+
+        return std::min< uint64_t >( _keySpace - 1, (uint64_t) ( _keySpace * std::pow( _eta * u - _eta + 1, _alpha ) ) );
+    }
+
+    mt19937_64          _random;
+    const Distribution  _distribution;
+    const size_t        _keySpace;
+    size_t              _next;          // SEQUENTIAL
+    const double        _theta;         // ZIPF
+    const double        _zetaN;
+    double              _alpha;
+    double              _eta;
+};
+
+bool parseConfig( int argc, char* argv[], BenchConfig& config )
+{
+    config = BenchConfig{ { 1, 2, 4, 8 }, READ_PERCENT, WRITE_PERCENT, DELETE_PERCENT, Distribution::UNIFORM,
+                          DEFAULT_ZIPF_THETA, KEY_SPACE, 0, PREFILL_PERCENT, DURATION_MS, 0, 1, RANDOM_SEED, false,
+                          MAP_HAS_STRIPES ? LOCK_STRIPES : 1, false };
+
+    for ( int i = 1; i < argc; ++i )
+    {
+        const std::string option = argv[ i ];
+        const char*       value  = ( i + 1 < argc ) ? argv[ i + 1 ] : nullptr;
+
+        if ( option == "--csv" )
+        {
+            config.isCsv = true;
+            continue;
+        }
+
+        if ( ( option == "--stripes" || option == "--optimistic" ) && !MAP_HAS_STRIPES )
+        {
+            LOG_ERR() << MAP_VARIANT << " has no " << option << endl;
+            return false;
+        }
+
+        if ( option == "--optimistic" )
+        {
+            config.isOptimistic = true;
+            continue;
+        }
+
+        if ( !value )
+        {
+            LOG_ERR() << "Missing value of " << option << endl;
+            return false;
+        }
+
+        ++i;
+
+        if ( option == "--threads" )
+        {
+            config.threads.clear();
+
+            for ( const char* next = value; *next; )
+            {
+                char* end = nullptr;
+                config.threads.push_back( std::strtoul( next, &end, 10 ) );
+
+                /* A count, then a comma or the end */
+                if ( end == next || ( *end != ',' && *end != '\0' ) )
+                {
+                    LOG_ERR() << "Thread counts must be numbers separated by commas: " << value << endl;
+                    return false;
+                }
+
+                next = ( *end == ',' ) ? end + 1 : end;
+            }
+        }
+        else if ( option == "--mix" )
+        {
+            /* read,write,delete percentages */
+            if ( sscanf( value, "%u,%u,%u", &config.readPercent, &config.writePercent, &config.deletePercent ) != 3 ||
+                 config.readPercent + config.writePercent + config.deletePercent != 100 )
+            {
+                LOG_ERR() << "Mix must be three percentages adding up to 100: " << value << endl;
+                return false;
+            }
+        }
+        else if ( option == "--dist" )
+        {
+            if      ( strcmp( value, "uniform" )    == 0 ) config.distribution = Distribution::UNIFORM;
+            else if ( strcmp( value, "zipf" )       == 0 ) config.distribution = Distribution::ZIPF;
+            else if ( strcmp( value, "sequential" ) == 0 ) config.distribution = Distribution::SEQUENTIAL;
+            else
+            {
+                LOG_ERR() << "Unknown distribution: " << value << endl;
+                return false;
+            }
+        }
+        else if ( option == "--theta" )    config.theta          = std::strtod( value, nullptr );
+        else if ( option == "--keys" )     config.keySpace       = std::strtoull( value, nullptr, 10 );
+        else if ( option == "--size" )     config.mapSize        = std::strtoull( value, nullptr, 10 );
+        else if ( option == "--prefill" )  config.prefillPercent = std::strtoul( value, nullptr, 10 );
+        else if ( option == "--duration" ) config.durationMs     = std::strtoull( value, nullptr, 10 );
+        else if ( option == "--ops" )      config.ops            = std::strtoull( value, nullptr, 10 );
+        else if ( option == "--sample" )   config.sampleEvery    = std::strtoull( value, nullptr, 10 );
+        else if ( option == "--seed" )     config.seed           = std::strtoull( value, nullptr, 10 );
+        else if ( option == "--stripes" )  config.stripes        = std::strtoull( value, nullptr, 10 );
+        else
+        {
+            LOG_ERR() << "Unknown option: " << option << endl;
+            return false;
+        }
+    }
+
+    if ( config.threads.empty() || std::count( config.threads.begin(), config.threads.end(), 0 ) ||
+         config.keySpace == 0 || config.sampleEvery == 0 || config.stripes == 0 || config.prefillPercent > 100 ||
+         config.theta <= 0 || config.theta >= 1 )
+    {
+        LOG_ERR() << "Thread counts, keys, sample and stripes must be positive, prefill at most 100, theta in (0, 1)" << endl;
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * One run: a fresh map, prefilled with the same keys for a seed, then
+ * nThreads threads doing the op mix until the duration is over or each
+ * did config.ops ops. Latencies cover the map call only; drawing keys
+ * costs throughput alike in every variant.
+ */
+void runBenchmark( const BenchConfig& config, const size_t nThreads, const double zetaN, ostream& out )
+{
+    const size_t size = config.mapSize ? config.mapSize : config.keySpace;
+
+#if MAP_HAS_STRIPES
+    BenchMap map{ size, config.stripes, DEFAULT_MAX_LOAD_FACTOR, DEFAULT_MIN_LOAD_FACTOR, config.isOptimistic };
+#else
+    BenchMap map{ size };
+#endif
+
+    for ( BenchKey key = 0; key < config.keySpace; ++key )
+    {
+        if ( mix64( config.seed ^ key ) % 100 < config.prefillPercent ) map.add( key, key );
+    }
+
+    vector< ThreadResult > results( nThreads );
+    vector< thread >       workers;
+    std::atomic< size_t >  nReady{ 0 };
+    std::atomic< bool >    isStarted{ false };
+    std::atomic< bool >    isStopped{ false };
+
+    for ( size_t i = 0; i < nThreads; ++i )
+    {
+        workers.emplace_back( [ &, i ]()
+        {
+            /* Kept local; results of neighbours share lines */
+            KeyGenerator keys( config, i, nThreads, zetaN );
+            ThreadResult result{};
+            BenchKey     value = 0;
+
+            nReady++;
+            while ( !isStarted.load( std::memory_order_acquire ) ) std::this_thread::yield();
+
+            for ( uint64_t n = 0; config.ops ? n < config.ops : !isStopped.load( std::memory_order_relaxed ); ++n )
+            {
+                const uint64_t percent = keys.below( 100 );
+                const BenchKey key     = keys.next();
+                const Op       op      = ( percent < config.readPercent )                       ? Op::FIND :
+                                         ( percent < config.readPercent + config.writePercent ) ? Op::ADD  : Op::DEL;
+
+                const bool     isTimed = ( n % config.sampleEvery == 0 );
+                const auto     start   = isTimed ? steady_clock::now() : steady_clock::time_point{};
+
+                switch ( op )
+                {
+                    case Op::FIND:
+                        result.finds++;
+                        if ( map.find( key, value ) ) result.hits++;
+                        break;
+
+                    case Op::ADD:
+                        map.add( key, key );
+                        break;
+
+                    case Op::DEL:
+                        map.del( key );
+                        break;
+                }
+
+                if ( isTimed )
+                {
+                    result.latencies.record( duration_cast< nanoseconds >( steady_clock::now() - start ).count() );
+                }
+
+                result.checksum += mix64( ( key << 2 ) | (uint64_t) op );
+                result.ops++;
+            }
+
+            results[ i ] = result;
+        } );
+    }
+
+    while ( nReady.load() < nThreads ) std::this_thread::yield();
+
+    const auto start = steady_clock::now();
+    isStarted.store( true, std::memory_order_release );
+
+    if ( !config.ops ) std::this_thread::sleep_for( std::chrono::milliseconds( config.durationMs ) );
+    isStopped = true;
+
+    for ( auto& worker : workers ) worker.join();
+
+    const duration< double > elapsed = steady_clock::now() - start;
+
+    ThreadResult total{};
+    for ( const ThreadResult& result : results )
+    {
+        total.latencies += result.latencies;
+        total.ops       += result.ops;
+        total.finds     += result.finds;
+        total.hits      += result.hits;
+        total.checksum  += result.checksum;
+    }
+
+    const double mops    = total.ops / elapsed.count() / 1e6;
+    const double hitRate = total.finds ? (double) total.hits / total.finds * 100 : 0;
+
+    if ( config.isCsv )
+    {
+        out << MAP_VARIANT << "," << config.stripes << "," << config.isOptimistic << "," << nThreads << ","
+             << fixed << setprecision( 3 ) << mops << ","
+             << total.latencies.percentile( 0.5 ) << "," << total.latencies.percentile( 0.99 ) << ","
+             << total.latencies.percentile( 0.999 ) << "," << setprecision( 2 ) << hitRate << ","
+             << total.ops << "," << std::hex << total.checksum << std::dec << endl;
+        return;
+    }
+
+    out << setw( 8 ) << nThreads << fixed << setprecision( 2 ) << setw( 10 ) << mops
+         << setw( 10 ) << total.latencies.percentile( 0.5 ) << setw( 10 ) << total.latencies.percentile( 0.99 )
+         << setw( 10 ) << total.latencies.percentile( 0.999 ) << setw( 9 ) << hitRate << "%"
+         << setw( 12 ) << total.ops << "  " << std::hex << total.checksum << std::dec << endl;
+}
+
+/*
+ * Runs the configured workload once per thread count. With --ops, every
+ * thread does a fixed number of ops and the checksum of the generated
+ * workload is the same on every build for a seed; single threaded runs
+ * also hit the same keys. Timed runs (--duration) only share the seed.
+ */
+void mapBenchmark( const BenchConfig& config, ostream& out )
+{
+    const char* distributions[] = { "uniform", "zipf", "sequential" };
+
+    /* O(key space); computed once for all runs */
+    const double zetaN = ( config.distribution == Distribution::ZIPF ) ? KeyGenerator::zeta( config.keySpace, config.theta ) : 0;
+
+    if ( config.isCsv )
+    {
+        out << "variant,stripes,optimistic,threads,mops,p50_ns,p99_ns,p999_ns,hit_percent,ops,checksum" << endl;
+    }
+    else
+    {
+        out << MAP_VARIANT << "; keys: " << config.keySpace << " " << distributions[ (unsigned int) config.distribution ];
+        if ( config.distribution == Distribution::ZIPF ) out << "(" << config.theta << ")";
+
+        out << ", mix: " << config.readPercent << "/" << config.writePercent << "/" << config.deletePercent
+             << ", prefill: " << config.prefillPercent << "%, seed: " << config.seed << ", ";
+
+        if ( MAP_HAS_STRIPES ) out << "stripes: " << config.stripes << ( config.isOptimistic ? " optimistic" : "" ) << ", ";
+
+        if ( config.ops ) out << config.ops << " ops per thread";
+        else              out << config.durationMs << " ms per run";
+
+        out << endl << setw( 8 ) << "threads" << setw( 10 ) << "Mops/s" << setw( 10 ) << "p50 ns"
+             << setw( 10 ) << "p99 ns" << setw( 10 ) << "p999 ns" << setw( 10 ) << "hits"
+             << setw( 12 ) << "ops" << "  checksum" << endl;
+    }
+
+    for ( const size_t nThreads : config.threads ) runBenchmark( config, nThreads, zetaN, out );
+}
+
+} // HashMapTest
+
+
+/*
+ * Options:
+ *   --threads 1,2,4,8     thread counts, one run each
+ *   --mix 80,15,5         read, write (add) and delete percentages
+ *   --dist uniform        key distribution: uniform, zipf or sequential
+ *   --theta 0.99          zipf skew
+ *   --keys 1048576        key space
+ *   --size N              initial map size; the key space by default
+ *   --prefill 50          percent of the key space added before a run
+ *   --duration 1000       ms per run
+ *   --ops N               ops per thread instead of a duration
+ *   --sample 1            time every Nth op
+ *   --seed 42             seed of the keys and ops
+ *   --csv                 CSV rows, for comparing variants and builds
+ *   --stripes 16          lock stripes (HashMap-TS-New)
+ *   --optimistic          optimistic reads (HashMap-TS-New)
+ *
+ * Results go to stdout; the maps log to cout, which is sent to stderr.
+ */
+int main( int argc, char* argv[] )
+{
+    HashMapTest::BenchConfig config;
+
+    /* Maps log to cout; keep their lines out of the results */
+    std::streambuf* results = cout.rdbuf( std::cerr.rdbuf() );
+    std::ostream    out( results );
+
+    const bool isParsed = HashMapTest::parseConfig( argc, argv, config );
+    if ( isParsed ) HashMapTest::mapBenchmark( config, out );
+
+    cout.rdbuf( results );
+    return isParsed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,247 @@
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unordered_map>
+#include "logger.hpp"
+#include "map_engine.hpp"
+
+
+namespace HashMapTest {
+
+using std::vector;
+using std::thread;
+using std::setw;
+using std::fixed;
+using std::setprecision;
+using std::mt19937;
+using std::chrono::steady_clock;
+using std::chrono::duration;
+
+/* typedef for TestKey */
+typedef uint64_t TestKey;
+
+/* What a run of one engine found */
+struct EngineResult
+{
+    const char* name;
+    double      mops;       // million operations per second over all threads
+    size_t      errors;     // answers that differ from the reference
+};
+
+/* Function Prototypes */
+template < MapEngine E >
+EngineResult engineBenchmark( const char* name );
+
+template < typename Map >
+size_t valueApiErrors( Map& map );
+
+bool engineComparison( void );
+
+/* Benchmark Default Configurations */
+enum BenchDefaults
+{
+    MAP_SIZE            = 1 << 10,      // small, so every engine resizes
+    KEYS_PER_THREAD     = 1 << 14,
+    NUM_OF_THREADS      = 4,
+    NUM_OF_OPS          = 1 << 18,      // per thread
+    NUM_OF_CHECKED_OPS  = 1 << 16,
+    RANDOM_SEED         = 42
+};
+
+/* Function Definitions */
+
+/*
+ * Every engine through TSMap: first single threaded against an
+ * unordered_map, answer by answer, then NUM_OF_THREADS threads mixing
+ * add / del / find on keys of their own, so the final contents are known
+ * and checked once all of them are done.
+ */
+template < MapEngine E >
+EngineResult engineBenchmark( const char* name )
+{
+    EngineResult result{ name, 0, 0 };
+
+    {
+        TSMap< TestKey, TestKey, E >                map{ MAP_SIZE };
+        std::unordered_map< TestKey, TestKey >      reference;
+        mt19937                                     random( RANDOM_SEED );
+
+        for ( size_t i = 0; i < NUM_OF_CHECKED_OPS; ++i )
+        {
+            const TestKey key   = random() % KEYS_PER_THREAD;
+            TestKey       value = 0;
+
+            switch ( random() % 3 )
+            {
+                case 0:
+                    map.add( key, i );
+                    reference[ key ] = i;
+                    break;
+
+                case 1:
+                    if ( map.del( key ) != ( reference.erase( key ) > 0 ) ) result.errors++;
+                    break;
+
+                default:
+                {
+                    const auto expected = reference.find( key );
+                    const bool isFound  = map.find( key, value );
+
+                    if ( isFound != ( expected != reference.end() ) ) result.errors++;
+                    else if ( isFound && value != expected->second ) result.errors++;
+                    break;
+                }
+            }
+        }
+
+        if ( map.length() != reference.size() ) result.errors++;
+    }
+
+    TSMap< TestKey, TestKey, E > map{ MAP_SIZE };
+    vector< vector< bool > >     isPresent( NUM_OF_THREADS, vector< bool >( KEYS_PER_THREAD, false ) );
+    vector< thread >             workers;
+
+    const auto start = steady_clock::now();
+
+    for ( size_t i = 0; i < NUM_OF_THREADS; ++i )
+    {
+        workers.emplace_back( [ &map, &isPresent, i ]()
+        {
+            mt19937 random( RANDOM_SEED + i );
+            TestKey value = 0;
+
+            for ( size_t j = 0; j < NUM_OF_OPS; ++j )
+            {
+                const size_t  index = random() % KEYS_PER_THREAD;
+                const TestKey key   = index * NUM_OF_THREADS + i;
+
+                switch ( random() % 4 )
+                {
+                    case 0:
+                        map.add( key, key );
+                        isPresent[ i ][ index ] = true;
+                        break;
+
+                    case 1:
+                        map.del( key );
+                        isPresent[ i ][ index ] = false;
+                        break;
+
+                    default:
+                        map.find( key, value );
+                        break;
+                }
+            }
+        } );
+    }
+
+    for ( auto& worker : workers ) worker.join();
+
+    const duration< double > elapsed = steady_clock::now() - start;
+
+    result.mops = NUM_OF_THREADS * NUM_OF_OPS / elapsed.count() / 1e6;
+
+    for ( size_t i = 0; i < NUM_OF_THREADS; ++i )
+    {
+        for ( size_t index = 0; index < KEYS_PER_THREAD; ++index )
+        {
+            const TestKey key   = index * NUM_OF_THREADS + i;
+            TestKey       value = 0;
+
+            if ( map.find( key, value ) != isPresent[ i ][ index ] ) result.errors++;
+            else if ( isPresent[ i ][ index ] && value != key ) result.errors++;
+        }
+    }
+
+    return result;
+}
+
+/* add with rvalue values and visit, on a map of strings; returns wrong answers */
+template < typename Map >
+size_t valueApiErrors( Map& map )
+{
+    size_t errors = 0;
+
+    for ( TestKey key = 0; key < KEYS_PER_THREAD; ++key )
+    {
+        std::string value( 32, (char) ( 'a' + key % 26 ) );
+        map.add( key, std::move( value ) );
+    }
+
+    for ( TestKey key = 0; key < KEYS_PER_THREAD; ++key )
+    {
+        bool isRight = false;
+
+        map.visit( key, [ &isRight, key ]( const std::string& value )
+        {
+            isRight = ( value.size() == 32 && value[ 0 ] == (char) ( 'a' + key % 26 ) );
+        } );
+
+        if ( !isRight ) errors++;
+    }
+
+    if ( map.visit( KEYS_PER_THREAD, []( const std::string& ) {} ) ) errors++;
+
+    return errors;
+}
+
+/* Returns false if any engine gave a wrong answer */
+bool engineComparison( void )
+{
+    /* Maps log while created; measure everything before printing */
+    vector< EngineResult > results;
+
+    results.push_back( engineBenchmark< MapEngine::CHAINED   >( "chained" ) );
+    results.push_back( engineBenchmark< MapEngine::FLAT      >( "flat" ) );
+    results.push_back( engineBenchmark< MapEngine::LOCK_FREE >( "lock-free" ) );
+    results.push_back( engineBenchmark< MapEngine::SHARDED   >( "sharded" ) );
+
+    size_t apiErrors = 0;
+    {
+        TSHashMap< TestKey, std::string > chained{ MAP_SIZE };
+        apiErrors += valueApiErrors( chained );
+
+        /* emplace leaves existing values alone */
+        if ( chained.emplace( 0, 8, 'x' ) ) apiErrors++;
+        if ( !chained.emplace( KEYS_PER_THREAD, 8, 'x' ) ) apiErrors++;
+
+        std::string value;
+        if ( !chained.find( 0, value ) || value[ 0 ] != 'a' ) apiErrors++;
+        if ( !chained.find( KEYS_PER_THREAD, value ) || value != std::string( 8, 'x' ) ) apiErrors++;
+
+        ShardedHashMap< TestKey, std::string > sharded{ MAP_SIZE };
+        apiErrors += valueApiErrors( sharded );
+    }
+
+    LOG_INF() << "Engines through TSMap; " << NUM_OF_THREADS << " threads, million operations per second" << endl;
+
+    cout << setw( 12 ) << "engine" << setw( 12 ) << "Mops/s" << setw( 10 ) << "errors" << endl;
+
+    size_t errors = apiErrors;
+    for ( const EngineResult& result : results )
+    {
+        cout << setw( 12 ) << result.name << fixed << setprecision( 2 )
+             << setw( 12 ) << result.mops << setw( 10 ) << result.errors << endl;
+
+        errors += result.errors;
+    }
+
+    cout << "Value API (add by move, emplace, visit) errors: " << apiErrors << endl;
+
+    if ( errors > 0 ) LOG_ERR() << "Engines gave " << errors << " wrong answers!" << endl;
+
+    return ( errors == 0 );
+}
+
+} // HashMapTest
+
+
+int main( void )
+{
+    return HashMapTest::engineComparison() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,119 @@
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "logger.hpp"
+#include "flat_hashmap.hpp"
+
+
+namespace HashMapTest {
+
+using std::vector;
+using std::setw;
+using std::fixed;
+using std::setprecision;
+using std::mt19937;
+using std::chrono::steady_clock;
+using std::chrono::duration;
+
+/* typedef for TestKey */
+typedef unsigned int TestKey;
+
+/* Function Prototypes */
+template < typename G >
+double probeBenchmark( const vector< TestKey >& keys, const vector< TestKey >& lookups );
+
+void flatProbeBenchmark( void );
+
+/* Benchmark Default Configurations */
+enum BenchDefaults
+{
+    TABLE_SIZE      = 1 << 20,
+    NUM_OF_LOOKUPS  = 1 << 22,
+    RANDOM_SEED     = 42
+};
+
+/* Load factors to compare probes at */
+const float LOAD_FACTORS[] = { 0.25f, 0.50f, 0.75f, 0.85f };
+
+/* Function Definitions */
+template < typename G >
+double probeBenchmark( const vector< TestKey >& keys, const vector< TestKey >& lookups )
+{
+    /* Fixed size table; stays below max load factor so it never grows */
+    FlatTable< TestKey, TestKey, DefaultHashFunction< TestKey >, G > table{ TABLE_SIZE };
+
+    for ( const TestKey key : keys ) table.add( key, key );
+
+    TestKey checksum = 0;
+
+    const auto start = steady_clock::now();
+
+    for ( const TestKey key : lookups )
+    {
+        const TestKey* value = table.find( key );
+        if ( value ) checksum += *value;
+    }
+
+    const duration< double, std::nano > elapsed = steady_clock::now() - start;
+
+    /* Keep lookups from being optimized away */
+    if ( checksum == 1 ) LOG_INF() << "Checksum: " << checksum << endl;
+
+    return ( elapsed.count() / lookups.size() );
+}
+
+void flatProbeBenchmark( void )
+{
+    LOG_INF() << "Flat table probe benchmark; table size: " << TABLE_SIZE
+              << ", lookups: " << NUM_OF_LOOKUPS << ", ns per lookup" << endl;
+
+    cout << setw( 12 ) << "load factor" << setw( 8 ) << "lookup"
+         << setw( 10 ) << "scalar"
+#if defined( __SSE2__ )
+         << setw( 10 ) << "sse2"
+#endif
+#if defined( __AVX2__ )
+         << setw( 10 ) << "avx2"
+#endif
+         << endl;
+
+    for ( const float loadFactor : LOAD_FACTORS )
+    {
+        mt19937 random( RANDOM_SEED );
+
+        /* Random keys hit random home slots; top bit tells misses apart */
+        vector< TestKey > keys( (size_t) ( TABLE_SIZE * loadFactor ) );
+        for ( auto& key : keys ) key = random() & 0x7FFFFFFF;
+
+        vector< TestKey > hits  ( NUM_OF_LOOKUPS );
+        vector< TestKey > misses( NUM_OF_LOOKUPS );
+        for ( auto& key : hits   ) key = keys[ random() % keys.size() ];
+        for ( auto& key : misses ) key = random() | 0x80000000;
+
+        for ( const auto* lookups : { &hits, &misses } )
+        {
+            cout << setw( 12 ) << fixed << setprecision( 2 ) << loadFactor
+                 << setw( 8 ) << ( lookups == &hits ? "hit" : "miss" )
+                 << setw( 10 ) << probeBenchmark< ScalarProbeGroup >( keys, *lookups )
+#if defined( __SSE2__ )
+                 << setw( 10 ) << probeBenchmark< Sse2ProbeGroup >( keys, *lookups )
+#endif
+#if defined( __AVX2__ )
+                 << setw( 10 ) << probeBenchmark< Avx2ProbeGroup >( keys, *lookups )
+#endif
+                 << endl;
+        }
+    }
+}
+
+} // HashMapTest
+
+
+int main( void )
+{
+    HashMapTest::flatProbeBenchmark();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,235 @@
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include "logger.hpp"
+#include "hashmap.hpp"
+
+
+namespace HashMapTest {
+
+using std::vector;
+using std::string;
+using std::setw;
+using std::fixed;
+using std::setprecision;
+using std::mt19937_64;
+using std::chrono::steady_clock;
+using std::chrono::duration;
+
+/* typedef for TestKey */
+typedef uint64_t TestKey;
+
+/* std::hash as a hash function of the maps, for comparison */
+class StdStringHashFunction
+{
+public:
+    HashType operator()( const string& key ) const
+    {
+        return std::hash< string >()( key );
+    }
+};
+
+/* Function Prototypes */
+template < typename K, typename F >
+void distribution( const char* hash, const char* name, const vector< K >& keys );
+
+template < typename F >
+double integerThroughput( const vector< TestKey >& keys );
+
+template < typename F >
+double stringThroughput( const vector< string >& keys );
+
+template < typename F >
+double mapThroughput( const vector< TestKey >& keys );
+
+void hashFunctionBenchmark( void );
+
+/* Benchmark Default Configurations */
+enum BenchDefaults
+{
+    NUM_OF_KEYS         = 1 << 20,
+    NUM_OF_BUCKETS      = 1 << 16,
+    KEY_STRIDE          = 1 << 10,
+    NUM_OF_HASHES       = 1 << 24,
+    NUM_OF_MAP_KEYS     = 1 << 14,
+    NUM_OF_LOCK_STRIPES = 4,
+    RANDOM_SEED         = 42
+};
+
+/* String lengths to measure throughput with */
+const size_t STRING_LENGTHS[] = { 8, 16, 64, 256, 4096 };
+
+/* Function Definitions */
+template < typename K, typename F >
+void distribution( const char* hash, const char* name, const vector< K >& keys )
+{
+    F                hashFunction;
+    vector< size_t > loads( NUM_OF_BUCKETS, 0 );
+
+    for ( const auto& key : keys ) loads[ reduceHash( hashFunction( key ), NUM_OF_BUCKETS ) ]++;
+
+    /* Chi-square over degrees of freedom; close to 1 for a uniform hash */
+    const double expected = (double) keys.size() / NUM_OF_BUCKETS;
+    double       sum      = 0;
+
+    for ( const size_t load : loads ) sum += ( load - expected ) * ( load - expected ) / expected;
+
+    cout << setw( 12 ) << hash << setw( 12 ) << name << fixed << setprecision( 2 )
+         << setw( 12 ) << sum / ( NUM_OF_BUCKETS - 1 )
+         << setw( 10 ) << *std::max_element( loads.begin(), loads.end() ) << endl;
+}
+
+template < typename F >
+double integerThroughput( const vector< TestKey >& keys )
+{
+    F        hashFunction;
+    HashType checksum = 0;
+
+    const auto start = steady_clock::now();
+
+    for ( size_t i = 0; i < NUM_OF_HASHES; ++i ) checksum += hashFunction( keys[ i & ( NUM_OF_KEYS - 1 ) ] );
+
+    const duration< double > elapsed = steady_clock::now() - start;
+
+    /* Keep hashes from being optimized away */
+    if ( checksum == 1 ) LOG_INF() << "Checksum: " << checksum << endl;
+
+    /* Million hashes per second */
+    return ( NUM_OF_HASHES / elapsed.count() / 1e6 );
+}
+
+template < typename F >
+double stringThroughput( const vector< string >& keys )
+{
+    F        hashFunction;
+    HashType checksum = 0;
+    size_t   bytes    = 0;
+
+    const auto start = steady_clock::now();
+
+    while ( bytes < ( (size_t) NUM_OF_HASHES << 4 ) )
+    {
+        for ( const auto& key : keys )
+        {
+            checksum += hashFunction( key );
+            bytes    += key.size();
+        }
+    }
+
+    const duration< double > elapsed = steady_clock::now() - start;
+
+    /* Keep hashes from being optimized away */
+    if ( checksum == 1 ) LOG_INF() << "Checksum: " << checksum << endl;
+
+    /* GB per second */
+    return ( bytes / elapsed.count() / 1e9 );
+}
+
+template < typename F >
+double mapThroughput( const vector< TestKey >& keys )
+{
+    TSHashMap< TestKey, TestKey, F > map{ DEFAULT_HASHMAP_SIZE, NUM_OF_LOCK_STRIPES };
+    TestKey value    = 0;
+    TestKey checksum = 0;
+
+    const auto start = steady_clock::now();
+
+    for ( const TestKey key : keys ) map.add( key, key );
+    for ( const TestKey key : keys ) if ( map.find( key, value ) ) checksum += value;
+
+    const duration< double > elapsed = steady_clock::now() - start;
+
+    /* Keep finds from being optimized away */
+    if ( checksum == 1 ) LOG_INF() << "Checksum: " << checksum << endl;
+
+    /* Million operations per second */
+    return ( 2 * keys.size() / elapsed.count() / 1e6 );
+}
+
+void hashFunctionBenchmark( void )
+{
+    mt19937_64 random( RANDOM_SEED );
+
+    vector< TestKey > sequential( NUM_OF_KEYS ), strided( NUM_OF_KEYS ), randomKeys( NUM_OF_KEYS );
+    vector< string >  strings( NUM_OF_KEYS );
+
+    for ( size_t i = 0; i < NUM_OF_KEYS; ++i )
+    {
+        sequential[ i ] = i;
+        strided[ i ]    = i * KEY_STRIDE;
+        randomKeys[ i ] = random();
+        strings[ i ]    = "key" + std::to_string( i );
+    }
+
+    /* Distribution quality */
+    LOG_INF() << "Distribution of " << NUM_OF_KEYS << " keys over " << NUM_OF_BUCKETS
+              << " buckets; chi-square / dof (1 is uniform), max bucket load" << endl;
+
+    cout << setw( 12 ) << "hash" << setw( 12 ) << "keys" << setw( 12 ) << "chi-square" << setw( 10 ) << "max" << endl;
+
+    distribution< TestKey, IdentityHashFunction< TestKey > > ( "identity",  "sequential", sequential );
+    distribution< TestKey, IdentityHashFunction< TestKey > > ( "identity",  "strided",    strided );
+    distribution< TestKey, IdentityHashFunction< TestKey > > ( "identity",  "random",     randomKeys );
+    distribution< TestKey, FibonacciHashFunction< TestKey > >( "fibonacci", "sequential", sequential );
+    distribution< TestKey, FibonacciHashFunction< TestKey > >( "fibonacci", "strided",    strided );
+    distribution< TestKey, FibonacciHashFunction< TestKey > >( "fibonacci", "random",     randomKeys );
+    distribution< TestKey, MixHashFunction< TestKey > >      ( "mix",       "sequential", sequential );
+    distribution< TestKey, MixHashFunction< TestKey > >      ( "mix",       "strided",    strided );
+    distribution< TestKey, MixHashFunction< TestKey > >      ( "mix",       "random",     randomKeys );
+    distribution< string, StringHashFunction >               ( "bytes",     "strings",    strings );
+    distribution< string, StdStringHashFunction >            ( "std::hash", "strings",    strings );
+
+    /* Integer throughput */
+    LOG_INF() << "Integer hashing; million hashes per second" << endl;
+
+    cout << setw( 12 ) << "identity"  << setw( 12 ) << integerThroughput< IdentityHashFunction< TestKey > >( randomKeys ) << endl;
+    cout << setw( 12 ) << "fibonacci" << setw( 12 ) << integerThroughput< FibonacciHashFunction< TestKey > >( randomKeys ) << endl;
+    cout << setw( 12 ) << "mix"       << setw( 12 ) << integerThroughput< MixHashFunction< TestKey > >( randomKeys ) << endl;
+
+    /* String throughput */
+    LOG_INF() << "String hashing; GB per second" << endl;
+
+    cout << setw( 10 ) << "length" << setw( 12 ) << "bytes" << setw( 12 ) << "std::hash" << endl;
+
+    for ( const size_t length : STRING_LENGTHS )
+    {
+        vector< string > keys( std::max< size_t >( 1, ( 1 << 20 ) / length ) );
+        for ( auto& key : keys )
+        {
+            key.resize( length );
+            for ( auto& c : key ) c = (char) random();
+        }
+
+        cout << setw( 10 ) << length << fixed << setprecision( 2 )
+             << setw( 12 ) << stringThroughput< StringHashFunction >( keys )
+             << setw( 12 ) << stringThroughput< StdStringHashFunction >( keys ) << endl;
+    }
+
+    /* Effect on the map; strided keys share low bits */
+    vector< TestKey > mapKeys( strided.begin(), strided.begin() + NUM_OF_MAP_KEYS );
+
+    const double identity  = mapThroughput< IdentityHashFunction< TestKey > >( mapKeys );
+    const double fibonacci = mapThroughput< FibonacciHashFunction< TestKey > >( mapKeys );
+    const double mix       = mapThroughput< MixHashFunction< TestKey > >( mapKeys );
+
+    LOG_INF() << "TSHashMap add + find of " << NUM_OF_MAP_KEYS << " strided keys; million operations per second" << endl;
+
+    cout << setw( 12 ) << "identity"  << fixed << setprecision( 2 ) << setw( 12 ) << identity  << endl;
+    cout << setw( 12 ) << "fibonacci" << fixed << setprecision( 2 ) << setw( 12 ) << fibonacci << endl;
+    cout << setw( 12 ) << "mix"       << fixed << setprecision( 2 ) << setw( 12 ) << mix       << endl;
+}
+
+} // HashMapTest
+
+
+int main( void )
+{
+    HashMapTest::hashFunctionBenchmark();
+    return EXIT_SUCCESS;
+}
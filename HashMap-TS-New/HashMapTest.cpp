@@ -2,6 +2,7 @@
 #include <cstdlib>
 #include <thread>
 #include <chrono>
+#include <sstream>
 #include "logger.hpp"
 #include "hashmap.hpp"
 
@@ -23,11 +24,14 @@ bool setupTestEnvironment( void );
 void writerCallback( void );
 void readerCallback( void );
 void hashmapTester ( void );
+bool reclaimTester ( void );
 
 /* Test Default Configurations */
 enum TestDefaults
 {
     GLOBAL_HASHMAP_SIZE     = 10,
+    NUM_OF_LOCK_STRIPES     = 4,
+    OPTIMISTIC_READS        = true,
     MAP_ENTRIES_AT_STARTUP  = 100,
     NUM_OF_WRITER_THREADS   = 15,
     NUM_OF_READER_THREADS   = 20,
@@ -36,14 +40,17 @@ enum TestDefaults
     WRITER_STARTUP_DELAY_MS = 100,
     READER_STARTUP_DELAY_MS = 200,
     WRITE_INTERVAL_IN_MS    = 50,
-    READ_INTERVAL_IN_MS     = 100
+    READ_INTERVAL_IN_MS     = 100,
+    NUM_OF_RECLAIM_THREADS  = 8,
+    NUM_OF_RECLAIM_KEYS     = EPOCH_RETIRE_BATCH / 2     // retires per thread; too few to collect
 };
 
 /* typedef for TestType */
 typedef unsigned int TestType;
 
 /* Global hash map for tester */
-TSHashMap< TestType, TestType > globalHashMap{ GLOBAL_HASHMAP_SIZE };
+TSHashMap< TestType, TestType > globalHashMap{ GLOBAL_HASHMAP_SIZE, NUM_OF_LOCK_STRIPES, DEFAULT_MAX_LOAD_FACTOR,
+                                               DEFAULT_MIN_LOAD_FACTOR, OPTIMISTIC_READS };
 
 /* Function Definitions */
 bool setupTestEnvironment( void )
@@ -77,9 +84,7 @@ void writerCallback( void )
     /* Introduce startup delay */
     sleep_for( milliseconds( WRITER_STARTUP_DELAY_MS ) );
 
-    LOCK_STREAM();
     LOG_INF() << "Writer thread started! TID: " << get_id() << endl;
-    UNLOCK_STREAM();
 
     /* Start of main test loop */
     for ( size_t i = 0; i < NUM_OF_WRITER_INTERVALS; ++i )
@@ -95,18 +100,14 @@ void writerCallback( void )
         {
             if ( globalHashMap.add( key, val ) )
             {
-                LOCK_STREAM();
                 LOG_INF() << "Writer thread (" << get_id() << ") added KV:{" << key << ", " << val << "}"<< endl;
-                UNLOCK_STREAM();
             }
         }
         else /* On ODD interval, delete a random entry */
         {
             if ( globalHashMap.del( key ) )
             {
-                LOCK_STREAM();
                 LOG_INF() << "Writer thread (" << get_id() << ") deleted entry K:{" << key << "}"<< endl;
-                UNLOCK_STREAM();
             }
         }
     }
@@ -117,9 +118,7 @@ void readerCallback( void )
     /* Introduce startup delay */
     sleep_for( milliseconds( READER_STARTUP_DELAY_MS ) );
 
-    LOCK_STREAM();
     LOG_INF() << "Reader thread started! TID: " << get_id() << endl;
-    UNLOCK_STREAM();
 
     /* Start of main test loop */
     for ( size_t i = 0; i < NUM_OF_READER_INTERVALS; ++i )
@@ -133,9 +132,7 @@ void readerCallback( void )
         /* Find the random entry and print */
         if ( globalHashMap.find( key, val ) )
         {
-            LOCK_STREAM();
             LOG_INF() << "Reader thread (" << get_id() << ") found KV:{" << key << ", " << val << "}"<< endl;
-            UNLOCK_STREAM();
         }
     }
 }
@@ -144,9 +141,10 @@ void hashmapTester( void )
 {
     if ( !setupTestEnvironment() ) return;
 
-    LOCK_STREAM();
+    /* Keep writing to stdout off the threads under test */
+    Logger::startAsync();
+
     LOG_INF() << "HashMap Test started!" << endl;
-    UNLOCK_STREAM();
 
 //    /* Resize test */
 //    for ( HashType k = 0, v = 100; k < 10; ++k, ++v )
@@ -183,6 +181,78 @@ void hashmapTester( void )
     /* Join writer and reader threads */
     for ( auto& wt : writerThreads ) wt.join();
     for ( auto& rt : readerThreads ) rt.join();
+
+    /* Report lock fairness */
+    const auto stats = globalHashMap.lockStats();
+
+    LOG_INF() << "Lock stats; reads: " << stats.readAcquires << " (waited: " << stats.readWaits
+              << ", " << stats.readWaitNs << " ns, max queue: " << stats.maxReadQueue << ")"
+              << ", writes: " << stats.writeAcquires << " (waited: " << stats.writeWaits
+              << ", " << stats.writeWaitNs << " ns, max queue: " << stats.maxWriteQueue << ")" << endl;
+
+    /* Report deleted entries that optimistic readers kept alive */
+    const auto reclaim = globalHashMap.reclaimStats();
+
+    LOG_INF() << "Reclaim stats; retired: " << reclaim.retired << ", freed: " << reclaim.freed
+              << ", pending: " << reclaim.pending << ", epoch: " << reclaim.epoch << endl;
+
+    /* Report shape of the table; read without locks */
+    const auto shape = globalHashMap.stats();
+
+    LOG_INF() << "Map stats; length: " << shape.length << ", size: " << shape.size
+              << ", occupied: " << shape.occupied << ", max chain: " << shape.maxChain << endl;
+
+    /* Report operation latencies; only recorded with make INSTRUMENT=1 */
+    std::ostringstream json;
+    globalHashMap.opStats().writeJson( json );
+
+    LOG_INF() << "Op stats: " << json.str() << endl;
+
+    /* Write pending log lines before the report on the logger itself */
+    Logger::stopAsync();
+
+    const auto logStats = Logger::stats();
+
+    LOG_INF() << "Log stats; written: " << logStats.written << ", dropped: " << logStats.dropped
+              << ", blocked: " << logStats.blocked << endl;
+}
+
+/*
+ * Short lived writers that retire fewer entries than a collection needs;
+ * exiting threads must collect their own, or they wait for the map to be
+ * destroyed. With no readers, nothing may be left pending once all have
+ * exited. Returns false otherwise.
+ */
+bool reclaimTester( void )
+{
+    TSHashMap< TestType, TestType > map{ GLOBAL_HASHMAP_SIZE, NUM_OF_LOCK_STRIPES, DEFAULT_MAX_LOAD_FACTOR,
+                                         DEFAULT_MIN_LOAD_FACTOR, OPTIMISTIC_READS };
+
+    thread writerThreads[ NUM_OF_RECLAIM_THREADS ] = {};
+
+    for ( size_t t = 0; t < NUM_OF_RECLAIM_THREADS; ++t )
+    {
+        writerThreads[ t ] = thread( [ &map, t ]()
+        {
+            for ( TestType i = 0; i < NUM_OF_RECLAIM_KEYS; ++i ) map.add( t * NUM_OF_RECLAIM_KEYS + i, i );
+            for ( TestType i = 0; i < NUM_OF_RECLAIM_KEYS; ++i ) map.del( t * NUM_OF_RECLAIM_KEYS + i );
+        } );
+    }
+
+    for ( auto& wt : writerThreads ) wt.join();
+
+    const auto reclaim = map.reclaimStats();
+
+    LOG_INF() << "Reclaim test; retired: " << reclaim.retired << ", freed: " << reclaim.freed
+              << ", pending: " << reclaim.pending << ", epoch: " << reclaim.epoch << endl;
+
+    if ( reclaim.freed == 0 || reclaim.pending > 0 )
+    {
+        LOG_ERR() << "Exited writers left " << reclaim.pending << " retired entries!" << endl;
+        return false;
+    }
+
+    return true;
 }
 
 } // HashMap Test
@@ -191,5 +261,5 @@ void hashmapTester( void )
 int main( void )
 {
     HashMapTest::hashmapTester();
-    return EXIT_SUCCESS;
+    return HashMapTest::reclaimTester() ? EXIT_SUCCESS : EXIT_FAILURE;
 }
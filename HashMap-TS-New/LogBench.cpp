@@ -0,0 +1,107 @@
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <chrono>
+#include <string>
+#include <unistd.h>
+#include "logger.hpp"
+
+
+namespace HashMapTest {
+
+using std::setw;
+using std::fixed;
+using std::setprecision;
+using std::chrono::steady_clock;
+using std::chrono::duration;
+
+/* Function Prototypes */
+void logBenchmark( void );
+
+/* Benchmark Default Configurations */
+enum BenchDefaults
+{
+    NUM_OF_LINES    = 1 << 18,
+};
+
+const char* BENCH_LOG_PATH = "LogBench.bin";
+
+/* ns per call of body over NUM_OF_LINES calls */
+template < typename Body >
+double timeLines( Body&& body )
+{
+    const auto start = steady_clock::now();
+
+    for ( size_t i = 0; i < NUM_OF_LINES; ++i ) body( i );
+
+    const duration< double, std::nano > elapsed = steady_clock::now() - start;
+    return elapsed.count() / NUM_OF_LINES;
+}
+
+/*
+ * Cost of a line on the calling thread: skipped by level, written to a
+ * binary log, and formatted to text as the sync and async modes do (the
+ * write to cout excluded). Decodes the binary log to check its lines.
+ */
+void logBenchmark( void )
+{
+    const double skippedNs = timeLines( []( const size_t i )
+    {
+        Logger::setLevel( Logger::Level::ERR );
+        LOG_INF() << "key: " << i << ", value: " << i * 2 << ", load: " << 0.75 << endl;
+    } );
+
+    Logger::setLevel( Logger::Level::INF );
+
+    if ( !Logger::openBinary( BENCH_LOG_PATH, ( NUM_OF_LINES + 16 ) * BINARY_LOG_RECORD_SIZE ) )
+    {
+        LOG_ERR() << "Failed to open " << BENCH_LOG_PATH << endl;
+        return;
+    }
+
+    const double binaryNs = timeLines( []( const size_t i )
+    {
+        LOG_INF() << "key: " << i << ", value: " << i * 2 << ", load: " << 0.75 << endl;
+    } );
+
+    const BinaryLog::Stats stats = BinaryLog::stats();
+    Logger::closeBinary();
+
+    /* Decode, keeping the first record to format it as the text modes do */
+    size_t nDecoded = 0;
+    string record, text;
+
+    BinaryLog::read( BENCH_LOG_PATH,
+        [ & ]( uint64_t, uint32_t, const unsigned int level, const char*, const char*,
+               const unsigned int line, const char* args, const size_t size )
+        {
+            if ( nDecoded++ > 0 ) return;
+
+            const Logger::Site site{ (Logger::Level) level, line, __FILE__, __FUNCTION__ };
+
+            record.assign( (const char*) &site, sizeof( site ) );
+            record.append( args, size );
+        } );
+
+    unlink( BENCH_LOG_PATH );
+
+    const double textNs = timeLines( [ & ]( const size_t )
+    {
+        text.clear();
+        Logger::format( record.data(), record.size(), text );
+    } );
+
+    cout << setw( 10 ) << "skipped" << setw( 10 ) << "binary" << setw( 10 ) << "text" << "  ns per line" << endl;
+    cout << fixed << setprecision( 1 )
+         << setw( 10 ) << skippedNs << setw( 10 ) << binaryNs << setw( 10 ) << textNs << endl;
+    cout << "Binary lines: " << stats.lines << ", dropped: " << stats.dropped << ", decoded: " << nDecoded << endl;
+}
+
+} // HashMapTest
+
+
+int main( void )
+{
+    HashMapTest::logBenchmark();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,56 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "logger.hpp"
+
+
+/*
+ * Writes the lines of a binary log (see Logger::openBinary) to cout in the
+ * Logger's text form. With -t, every line starts with its timestamp (ns
+ * since epoch) and thread number.
+ */
+int main( int argc, char* argv[] )
+{
+    const bool  hasStamps = ( argc > 2 && strcmp( argv[ 1 ], "-t" ) == 0 );
+    const char* path      = hasStamps ? argv[ 2 ] : ( argc > 1 ? argv[ 1 ] : nullptr );
+
+    if ( !path )
+    {
+        std::cerr << "Usage: " << argv[ 0 ] << " [-t] <binary log>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::string record, text;
+    size_t      nLines = 0;
+
+    const bool isRead = BinaryLog::read( path,
+        [ & ]( const uint64_t timestamp, const uint32_t thread, const unsigned int level,
+               const char* file, const char* func, const unsigned int line, const char* args, const size_t size )
+        {
+            /* Rebuild the Logger's record; names point into the decoder's copy */
+            const Logger::Site site{ (Logger::Level) level, line, file, func };
+
+            record.assign( (const char*) &site, sizeof( site ) );
+            record.append( args, size );
+
+            text.clear();
+            if ( hasStamps ) text += std::to_string( timestamp ) + " " + std::to_string( thread ) + " ";
+
+            Logger::format( record.data(), record.size(), text );
+
+            std::cout << text;
+            ++nLines;
+        } );
+
+    if ( !isRead )
+    {
+        std::cerr << "Not a binary log: " << path << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout.flush();
+    std::cerr << nLines << " lines" << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,172 @@
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+#include "logger.hpp"
+#include "sharded_hashmap.hpp"
+
+
+namespace HashMapTest {
+
+using std::vector;
+using std::thread;
+using std::setw;
+using std::fixed;
+using std::setprecision;
+using std::mt19937_64;
+using std::chrono::steady_clock;
+using std::chrono::duration;
+
+/* typedef for TestKey */
+typedef uint64_t TestKey;
+
+/* typedef for the benchmarked map */
+typedef ShardedHashMap< TestKey, TestKey > BenchMap;
+
+/* Where a benchmark run puts shards and which keys its threads use */
+enum class Placement { UNPLACED, PLACED_ANY_KEYS, PLACED_LOCAL_KEYS };
+
+/* Function Prototypes */
+double numaBenchmark( const Placement placement, double& localShare );
+
+void numaPlacementBenchmark( const size_t simulatedNodes );
+
+/* Benchmark Default Configurations */
+enum BenchDefaults
+{
+    NUM_OF_ENTRIES      = 1 << 20,
+    SHARDS_PER_NODE     = 4,
+    THREADS_PER_NODE    = 2,
+    NUM_OF_OPS          = 1 << 20,      // per thread
+    FINDS_PER_ADD       = 9,
+    RANDOM_SEED         = 42
+};
+
+/* Function Definitions */
+double numaBenchmark( const Placement placement, double& localShare )
+{
+    const size_t nodes = NumaTopology::nodes();
+
+    BenchMap map{ NUM_OF_ENTRIES, nodes * SHARDS_PER_NODE, 4 };
+
+    if ( placement != Placement::UNPLACED ) map.placeOnNodes();
+
+    for ( TestKey key = 0; key < NUM_OF_ENTRIES; ++key ) map.add( key, key );
+
+    vector< thread >   workers;
+    vector< size_t >   nLocal( nodes * THREADS_PER_NODE, 0 );
+    std::atomic< int > nReady{ 0 };
+    std::atomic< bool > isStarted{ false };
+
+    for ( size_t i = 0; i < nodes * THREADS_PER_NODE; ++i )
+    {
+        workers.emplace_back( [ &, i ]()
+        {
+            NumaTopology::bindThread( (int) ( i % nodes ) );
+
+            /* Draw keys up front; local runs keep only keys of local shards */
+            mt19937_64        random( RANDOM_SEED + i );
+            vector< TestKey > keys;
+            keys.reserve( NUM_OF_OPS );
+
+            while ( keys.size() < NUM_OF_OPS )
+            {
+                const TestKey key = random() % ( 2 * NUM_OF_ENTRIES );
+                if ( placement == Placement::PLACED_LOCAL_KEYS && !map.isLocal( key ) ) continue;
+
+                keys.push_back( key );
+                if ( map.isLocal( key ) ) nLocal[ i ]++;
+            }
+
+            ++nReady;
+            while ( !isStarted ) std::this_thread::yield();
+
+            TestKey value    = 0;
+            TestKey checksum = 0;
+
+            for ( size_t j = 0; j < keys.size(); ++j )
+            {
+                if ( j % ( FINDS_PER_ADD + 1 ) == 0 )
+                {
+                    map.add( keys[ j ], j );
+                }
+                else if ( map.find( keys[ j ], value ) )
+                {
+                    checksum += value;
+                }
+            }
+
+            /* Keep finds from being optimized away */
+            if ( checksum == 1 ) LOG_INF() << "Checksum: " << checksum << endl;
+        } );
+    }
+
+    while ( nReady < (int) workers.size() ) std::this_thread::yield();
+
+    const auto start = steady_clock::now();
+    isStarted = true;
+
+    for ( auto& worker : workers ) worker.join();
+
+    const duration< double > elapsed = steady_clock::now() - start;
+
+    size_t nLocalOps = 0;
+    for ( const size_t n : nLocal ) nLocalOps += n;
+
+    localShare = (double) nLocalOps / ( workers.size() * NUM_OF_OPS );
+
+    /* Million operations per second over all threads */
+    return ( workers.size() * NUM_OF_OPS / elapsed.count() / 1e6 );
+}
+
+void numaPlacementBenchmark( const size_t simulatedNodes )
+{
+    if ( simulatedNodes > 0 ) NumaTopology::simulate( simulatedNodes );
+
+    LOG_INF() << "NUMA placement benchmark; nodes: " << NumaTopology::nodes()
+              << ( NumaTopology::isSimulated() ? " (simulated)" : "" )
+              << ", shards per node: " << SHARDS_PER_NODE << ", threads per node: " << THREADS_PER_NODE
+              << ", million operations per second" << endl;
+
+    const Placement placements[] = { Placement::UNPLACED, Placement::PLACED_ANY_KEYS, Placement::PLACED_LOCAL_KEYS };
+    const char*     names[]      = { "unplaced", "placed", "placed+local" };
+
+    /* Maps log while created; measure everything before printing */
+    vector< double > results, localShares;
+
+    for ( const Placement placement : placements )
+    {
+        double localShare = 0;
+        results.push_back( numaBenchmark( placement, localShare ) );
+        localShares.push_back( localShare );
+    }
+
+    const NumaTopology::Stats stats = NumaTopology::stats();
+
+    cout << setw( 14 ) << "placement" << setw( 12 ) << "Mops/s" << setw( 12 ) << "local" << endl;
+
+    for ( size_t i = 0; i < results.size(); ++i )
+    {
+        cout << setw( 14 ) << names[ i ] << fixed << setprecision( 2 )
+             << setw( 12 ) << results[ i ] << setw( 11 ) << localShares[ i ] * 100 << "%" << endl;
+    }
+
+    cout << "Bound " << stats.boundBytes / ( 1 << 20 ) << " MB, failed binds: " << stats.failedBinds << endl;
+}
+
+} // HashMapTest
+
+
+/* Optional argument: number of nodes to simulate; simulates 2 on single node hosts */
+int main( int argc, char* argv[] )
+{
+    size_t simulatedNodes = ( argc > 1 ) ? std::strtoul( argv[ 1 ], nullptr, 10 ) : 0;
+
+    if ( argc <= 1 && HashMapTest::NumaTopology::nodes() == 1 ) simulatedNodes = 2;
+
+    HashMapTest::numaPlacementBenchmark( simulatedNodes );
+    return EXIT_SUCCESS;
+}
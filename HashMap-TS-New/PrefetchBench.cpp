@@ -0,0 +1,127 @@
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "logger.hpp"
+#include "hashmap.hpp"
+
+
+namespace HashMapTest {
+
+using std::vector;
+using std::setw;
+using std::fixed;
+using std::setprecision;
+using std::mt19937;
+using std::chrono::steady_clock;
+using std::chrono::duration;
+
+/* typedef for TestKey */
+typedef unsigned int TestKey;
+
+/* typedef for the benchmarked map */
+typedef TSHashMap< TestKey, TestKey > BenchMap;
+
+/* Function Prototypes */
+double findBenchmark     ( BenchMap& map, const vector< TestKey >& keys );
+double findManyBenchmark ( BenchMap& map, const vector< TestKey >& keys, const size_t batchSize );
+
+void prefetchBenchmark( void );
+
+/* Benchmark Default Configurations; table and entries are far beyond LLC */
+enum BenchDefaults
+{
+    MAP_SIZE            = 1 << 24,
+    NUM_OF_ENTRIES      = 1 << 23,
+    NUM_OF_LOCK_STRIPES = 4,
+    NUM_OF_FINDS        = 1 << 22,
+    RANDOM_SEED         = 42
+};
+
+/* Batch sizes to measure findMany with */
+const size_t BATCH_SIZES[] = { 8, 64, 512, 4096 };
+
+/* Function Definitions */
+double findBenchmark( BenchMap& map, const vector< TestKey >& keys )
+{
+    TestKey value    = 0;
+    TestKey checksum = 0;
+
+    const auto start = steady_clock::now();
+
+    for ( const TestKey key : keys )
+    {
+        if ( map.find( key, value ) ) checksum += value;
+    }
+
+    const duration< double > elapsed = steady_clock::now() - start;
+
+    /* Keep finds from being optimized away */
+    if ( checksum == 1 ) LOG_INF() << "Checksum: " << checksum << endl;
+
+    /* Million finds per second */
+    return ( keys.size() / elapsed.count() / 1e6 );
+}
+
+double findManyBenchmark( BenchMap& map, const vector< TestKey >& keys, const size_t batchSize )
+{
+    vector< TestKey > values( batchSize );
+    size_t            nFound = 0;
+
+    const auto start = steady_clock::now();
+
+    for ( size_t i = 0; i < keys.size(); i += batchSize )
+    {
+        const size_t count = std::min( batchSize, keys.size() - i );
+        nFound += map.findMany( &keys[ i ], values.data(), nullptr, count );
+    }
+
+    const duration< double > elapsed = steady_clock::now() - start;
+
+    /* Keep finds from being optimized away */
+    if ( nFound == 1 ) LOG_INF() << "Found: " << nFound << endl;
+
+    /* Million finds per second */
+    return ( keys.size() / elapsed.count() / 1e6 );
+}
+
+void prefetchBenchmark( void )
+{
+    LOG_INF() << "Prefetch benchmark; map size: " << MAP_SIZE << ", entries: " << NUM_OF_ENTRIES
+              << ", stripes: " << NUM_OF_LOCK_STRIPES << ", finds: " << NUM_OF_FINDS
+              << ", million finds per second" << endl;
+
+    BenchMap map{ MAP_SIZE, NUM_OF_LOCK_STRIPES };
+
+    for ( TestKey key = 0; key < NUM_OF_ENTRIES; ++key ) map.add( key, key );
+
+    /* Random keys, half of them missing */
+    mt19937 random( RANDOM_SEED );
+    vector< TestKey > keys( NUM_OF_FINDS );
+    for ( auto& key : keys ) key = random() % ( 2 * NUM_OF_ENTRIES );
+
+    const double baseline = findBenchmark( map, keys );
+
+    vector< double > batched;
+    for ( const size_t batchSize : BATCH_SIZES ) batched.push_back( findManyBenchmark( map, keys, batchSize ) );
+
+    cout << setw( 10 ) << "batch" << setw( 12 ) << "find" << setw( 12 ) << "findMany" << setw( 10 ) << "speedup" << endl;
+
+    for ( size_t i = 0; i < batched.size(); ++i )
+    {
+        cout << setw( 10 ) << BATCH_SIZES[ i ] << fixed << setprecision( 2 )
+             << setw( 12 ) << baseline << setw( 12 ) << batched[ i ]
+             << setw( 10 ) << batched[ i ] / baseline << endl;
+    }
+}
+
+} // HashMapTest
+
+
+int main( void )
+{
+    HashMapTest::prefetchBenchmark();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,116 @@
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+#include "logger.hpp"
+#include "hashmap.hpp"
+
+
+namespace HashMapTest {
+
+using std::vector;
+using std::thread;
+using std::setw;
+using std::fixed;
+using std::setprecision;
+using std::mt19937;
+using std::chrono::steady_clock;
+using std::chrono::duration;
+
+/* typedef for TestKey */
+typedef unsigned int TestKey;
+
+/* Function Prototypes */
+template < typename L >
+double readerBenchmark( const size_t nThreads, const bool optimisticReads = false );
+
+void readerScalingBenchmark( void );
+
+/* Benchmark Default Configurations */
+enum BenchDefaults
+{
+    MAP_SIZE            = 1 << 16,
+    NUM_OF_LOCK_STRIPES = 4,
+    NUM_OF_FINDS        = 1 << 20,      // per thread
+    RANDOM_SEED         = 42
+};
+
+/* Reader threads to measure with */
+const size_t READER_THREADS[] = { 1, 2, 4, 8, 16 };
+
+/* Function Definitions */
+template < typename L >
+double readerBenchmark( const size_t nThreads, const bool optimisticReads )
+{
+    TSHashMap< TestKey, TestKey, DefaultHashFunction< TestKey >, PoolAllocator< Entry< TestKey, TestKey > >, L >
+        map{ MAP_SIZE, NUM_OF_LOCK_STRIPES, DEFAULT_MAX_LOAD_FACTOR, DEFAULT_MIN_LOAD_FACTOR, optimisticReads };
+
+    for ( TestKey key = 0; key < MAP_SIZE / 2; ++key ) map.add( key, key );
+
+    vector< thread > readers;
+
+    const auto start = steady_clock::now();
+
+    for ( size_t i = 0; i < nThreads; ++i )
+    {
+        readers.emplace_back( [ &map, i ]()
+        {
+            mt19937 random( RANDOM_SEED + i );
+            TestKey value    = 0;
+            TestKey checksum = 0;
+
+            for ( size_t j = 0; j < NUM_OF_FINDS; ++j )
+            {
+                if ( map.find( random() % MAP_SIZE, value ) ) checksum += value;
+            }
+
+            /* Keep finds from being optimized away */
+            if ( checksum == 1 ) LOG_INF() << "Checksum: " << checksum << endl;
+        } );
+    }
+
+    for ( auto& reader : readers ) reader.join();
+
+    const duration< double > elapsed = steady_clock::now() - start;
+
+    /* Million finds per second over all threads */
+    return ( nThreads * NUM_OF_FINDS / elapsed.count() / 1e6 );
+}
+
+void readerScalingBenchmark( void )
+{
+    LOG_INF() << "Reader scaling benchmark; map size: " << MAP_SIZE << ", stripes: " << NUM_OF_LOCK_STRIPES
+              << ", finds per thread: " << NUM_OF_FINDS << ", million finds per second" << endl;
+
+    /* Maps log while created; measure everything before printing */
+    vector< double > rwLock, scalable, optimistic;
+
+    for ( const size_t nThreads : READER_THREADS )
+    {
+        rwLock.push_back    ( readerBenchmark< ReadWriteLock >( nThreads ) );
+        scalable.push_back  ( readerBenchmark< ScalableReadWriteLock >( nThreads ) );
+        optimistic.push_back( readerBenchmark< ReadWriteLock >( nThreads, true ) );
+    }
+
+    cout << setw( 10 ) << "threads" << setw( 12 ) << "rwlock" << setw( 12 ) << "scalable"
+         << setw( 12 ) << "optimistic" << endl;
+
+    for ( size_t i = 0; i < rwLock.size(); ++i )
+    {
+        cout << setw( 10 ) << READER_THREADS[ i ] << fixed << setprecision( 2 )
+             << setw( 12 ) << rwLock[ i ] << setw( 12 ) << scalable[ i ]
+             << setw( 12 ) << optimistic[ i ] << endl;
+    }
+}
+
+} // HashMapTest
+
+
+int main( void )
+{
+    HashMapTest::readerScalingBenchmark();
+    return EXIT_SUCCESS;
+}
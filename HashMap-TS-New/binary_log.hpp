@@ -0,0 +1,403 @@
+#ifndef BINARY_LOG_HPP_
+#define BINARY_LOG_HPP_
+
+#include <mutex>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+const size_t BINARY_LOG_RECORD_SIZE = 128;          // bytes of every record
+const size_t BINARY_LOG_SITES       = 4096;         // call sites; power of two
+const char   BINARY_LOG_MAGIC[ 8 ]  = "HMBLOG1";
+
+
+/** BinaryLog Class - Definition **/
+
+/*
+ * Log records in a memory mapped file, for the Logger (see openBinary).
+ * Every record has the same size: a header with timestamp, level, call
+ * site id and a small thread number, and the raw bytes of the line's
+ * arguments. A line whose arguments don't fit goes on in CONTINUATION
+ * records right after it.
+ *
+ * Writers reserve their records with one atomic add and copy them into
+ * the mapping; there's no lock and no system call per line. Call sites
+ * are keyed by file name pointer and line; the first line of a site
+ * writes a SITE record with its file and function names, so lines only
+ * carry the site id. When the file is full, lines are dropped and
+ * counted.
+ *
+ * Records are published by writing their type last, so read skips lines
+ * that were being written when the file was copied. Open and close while
+ * no other thread logs. The LogDecoder tool renders a file as text.
+ */
+class BinaryLog
+{
+public:
+    enum Type : uint8_t { EMPTY, LINE, SITE, CONTINUATION };
+
+    struct Record
+    {
+        uint64_t    timestamp;  // ns since epoch
+        uint32_t    thread;     // thread number, in order of first line
+        uint32_t    site;       // call site id
+        uint8_t     type;
+        uint8_t     level;
+        uint16_t    length;     // payload bytes in this record
+        uint32_t    records;    // records of the line, this one included
+        char        payload[ BINARY_LOG_RECORD_SIZE - 24 ];
+    };
+
+    static_assert( sizeof( Record ) == BINARY_LOG_RECORD_SIZE, "Record must fill BINARY_LOG_RECORD_SIZE" );
+
+    struct Stats
+    {
+        uint64_t    lines;      // lines written
+        uint64_t    dropped;    // lines that didn't fit
+        uint64_t    sites;      // call sites registered
+    };
+
+    static inline bool open( const char* path, const size_t bytes )
+    {
+        State& thisState = state();
+
+        if ( thisState.isOpen ) return false;
+
+        const size_t capacity = std::max< size_t >( bytes / sizeof( Record ), 2 );
+
+        const int file = ::open( path, O_RDWR | O_CREAT | O_TRUNC, 0644 );
+        if ( file < 0 ) return false;
+
+        void* mapping = MAP_FAILED;
+        if ( ftruncate( file, capacity * sizeof( Record ) ) == 0 )
+        {
+            mapping = mmap( nullptr, capacity * sizeof( Record ), PROT_READ | PROT_WRITE, MAP_SHARED, file, 0 );
+        }
+
+        if ( mapping == MAP_FAILED )
+        {
+            ::close( file );
+            return false;
+        }
+
+        thisState.file     = file;
+        thisState.records  = (Record*) mapping;
+        thisState.capacity = capacity;
+        thisState.next     = 1;     // first record is the file header
+
+        /* File header; the decoder checks magic and record size */
+        Record& header = thisState.records[ 0 ];
+        memcpy( header.payload, BINARY_LOG_MAGIC, sizeof( BINARY_LOG_MAGIC ) );
+        header.length = sizeof( Record );
+
+        for ( auto& site : thisState.sites ) site.id = 0;
+
+        thisState.nSites  = 0;
+        thisState.lines   = 0;
+        thisState.dropped = 0;
+        thisState.isOpen  = true;
+
+        return true;
+    }
+
+    static inline bool close( void )
+    {
+        State& thisState = state();
+
+        if ( !thisState.isOpen ) return false;
+
+        thisState.isOpen = false;
+
+        /* Cut the file to the records written */
+        const size_t used = std::min( thisState.next.load(), thisState.capacity );
+
+        munmap( thisState.records, thisState.capacity * sizeof( Record ) );
+
+        const bool isCut = ( ftruncate( thisState.file, used * sizeof( Record ) ) == 0 );
+        ::close( thisState.file );
+
+        thisState.records = nullptr;
+
+        return isCut;
+    }
+
+    static inline bool isOpen( void )
+    {
+        return state().isOpen.load( std::memory_order_relaxed );
+    }
+
+    /* A line of the call site file:line in func; args in the Logger's record format */
+    static inline bool write( const unsigned int level, const char* file, const char* func, const unsigned int line,
+                              const char* args, const size_t size )
+    {
+        State&         thisState = state();
+        const uint32_t site      = siteOf( level, file, func, line );
+
+        if ( site == 0 || !append( LINE, level, site, args, size ) )
+        {
+            thisState.dropped.fetch_add( 1, std::memory_order_relaxed );
+            return false;
+        }
+
+        thisState.lines.fetch_add( 1, std::memory_order_relaxed );
+        return true;
+    }
+
+    static inline Stats stats( void )
+    {
+        const State& thisState = state();
+
+        return Stats{ thisState.lines.load( std::memory_order_relaxed ),
+                      thisState.dropped.load( std::memory_order_relaxed ),
+                      thisState.nSites.load( std::memory_order_relaxed ) };
+    }
+
+    /*
+     * Calls visitor( timestamp, thread, level, file, func, line, args, size )
+     * for every complete line of the file at path, in file order.
+     */
+    template < typename Visitor >
+    static inline bool read( const char* path, Visitor&& visitor )
+    {
+        const int file = ::open( path, O_RDONLY );
+        if ( file < 0 ) return false;
+
+        struct stat info;
+        if ( fstat( file, &info ) != 0 || (size_t) info.st_size < sizeof( Record ) )
+        {
+            ::close( file );
+            return false;
+        }
+
+        const size_t count   = info.st_size / sizeof( Record );
+        void*        mapping = mmap( nullptr, count * sizeof( Record ), PROT_READ, MAP_PRIVATE, file, 0 );
+
+        ::close( file );
+
+        if ( mapping == MAP_FAILED ) return false;
+
+        const Record* records = (const Record*) mapping;
+
+        if ( memcmp( records[ 0 ].payload, BINARY_LOG_MAGIC, sizeof( BINARY_LOG_MAGIC ) ) != 0 ||
+             records[ 0 ].length != sizeof( Record ) )
+        {
+            munmap( mapping, count * sizeof( Record ) );
+            return false;
+        }
+
+        struct SiteInfo
+        {
+            std::string     file;
+            std::string     func;
+            unsigned int    line;
+        };
+
+        /* Site ids start at 1 */
+        std::vector< SiteInfo > sites( BINARY_LOG_SITES + 1 );
+        std::string             payload;
+
+        for ( size_t i = 1; i < count; )
+        {
+            const Record& record = records[ i ];
+
+            /* Unfinished or stray record */
+            if ( record.type != LINE && record.type != SITE )
+            {
+                ++i;
+                continue;
+            }
+
+            payload.clear();
+
+            const size_t nRecords = std::max< uint32_t >( record.records, 1 );
+            for ( size_t j = i; j < i + nRecords && j < count; ++j )
+            {
+                payload.append( records[ j ].payload, std::min< size_t >( records[ j ].length, sizeof( record.payload ) ) );
+            }
+
+            if ( record.type == SITE && record.site <= BINARY_LOG_SITES )
+            {
+                /* line, then file and func names, each ended by a zero */
+                SiteInfo& site = sites[ record.site ];
+                uint32_t  line = 0;
+
+                memcpy( &line, payload.data(), sizeof( line ) );
+
+                const size_t funcAt = payload.find( '\0', sizeof( line ) ) + 1;
+
+                site.line = line;
+                site.file = payload.substr( sizeof( line ), funcAt - 1 - sizeof( line ) );
+                site.func = payload.substr( funcAt, payload.find( '\0', funcAt ) - funcAt );
+            }
+            else if ( record.type == LINE && record.site <= BINARY_LOG_SITES )
+            {
+                const SiteInfo& site = sites[ record.site ];
+
+                visitor( record.timestamp, record.thread, (unsigned int) record.level,
+                         site.file.c_str(), site.func.c_str(), site.line, payload.data(), payload.size() );
+            }
+
+            i += nRecords;
+        }
+
+        munmap( mapping, count * sizeof( Record ) );
+
+        return true;
+    }
+
+private:
+    /* Call site; id 0 while free, published last */
+    struct SiteSlot
+    {
+        std::atomic< const char* >  file;
+        std::atomic< unsigned int > line;
+        std::atomic< uint32_t >     id;
+    };
+
+    struct State
+    {
+        std::atomic< bool >         isOpen;
+        int                         file;
+        Record*                     records;
+        size_t                      capacity;   // records in the file
+        std::atomic< size_t >       next;       // next free record
+        std::mutex                  siteMutex;  // serializes new sites only
+        SiteSlot                    sites[ BINARY_LOG_SITES ];
+        std::atomic< uint32_t >     nSites;
+        std::atomic< uint64_t >     lines;
+        std::atomic< uint64_t >     dropped;
+
+        State() : isOpen{ false }, file{ -1 }, records{ nullptr }, capacity{ 0 }, next{ 0 },
+                  nSites{ 0 }, lines{ 0 }, dropped{ 0 }
+        {
+            for ( auto& site : sites ) site.id = 0;
+        }
+
+        ~State()
+        {
+            close();
+        }
+    };
+
+    static inline State& state( void )
+    {
+        static State thisState;
+        return thisState;
+    }
+
+    static inline uint32_t threadNumber( void )
+    {
+        static std::atomic< uint32_t > lastNumber{ 0 };
+        static thread_local uint32_t   number = ++lastNumber;
+
+        return number;
+    }
+
+    static inline uint32_t siteOf( const unsigned int level, const char* file, const char* func,
+                                   const unsigned int line )
+    {
+        State&       thisState = state();
+        const size_t mask      = BINARY_LOG_SITES - 1;
+        const size_t start     = ( ( (uintptr_t) file >> 3 ) * 31 + line ) & mask;
+
+        /* Known site; ids are published after file and line */
+        for ( size_t i = start, probes = 0; probes < BINARY_LOG_SITES; i = ( i + 1 ) & mask, ++probes )
+        {
+            const uint32_t id = thisState.sites[ i ].id.load( std::memory_order_acquire );
+
+            if ( id == 0 ) break;
+
+            if ( thisState.sites[ i ].file.load( std::memory_order_relaxed ) == file &&
+                 thisState.sites[ i ].line.load( std::memory_order_relaxed ) == line )
+            {
+                return id;
+            }
+        }
+
+        /* New site; register it and write its names once */
+        std::lock_guard< std::mutex > lock( thisState.siteMutex );
+
+        for ( size_t i = start, probes = 0; probes < BINARY_LOG_SITES; i = ( i + 1 ) & mask, ++probes )
+        {
+            SiteSlot& slot = thisState.sites[ i ];
+
+            if ( slot.id.load( std::memory_order_relaxed ) != 0 )
+            {
+                if ( slot.file.load( std::memory_order_relaxed ) == file &&
+                     slot.line.load( std::memory_order_relaxed ) == line )
+                {
+                    return slot.id;
+                }
+
+                continue;
+            }
+
+            const uint32_t id = (uint32_t) i + 1;
+            std::string    names( (const char*) &line, sizeof( uint32_t ) );
+
+            names.append( file ).push_back( '\0' );
+            names.append( func ).push_back( '\0' );
+
+            if ( !append( SITE, level, id, names.data(), names.size() ) ) return 0;
+
+            slot.file.store( file, std::memory_order_relaxed );
+            slot.line.store( line, std::memory_order_relaxed );
+            slot.id.store( id, std::memory_order_release );
+
+            thisState.nSites.fetch_add( 1, std::memory_order_relaxed );
+
+            return id;
+        }
+
+        return 0;
+    }
+
+    static inline bool append( const Type type, const unsigned int level, const uint32_t site,
+                               const char* payload, const size_t size )
+    {
+        State&       thisState = state();
+        const size_t perRecord = sizeof( Record::payload );
+        const size_t nRecords  = std::max< size_t >( ( size + perRecord - 1 ) / perRecord, 1 );
+        const size_t first     = thisState.next.fetch_add( nRecords, std::memory_order_relaxed );
+
+        if ( first + nRecords > thisState.capacity ) return false;
+
+        const uint64_t timestamp = std::chrono::duration_cast< std::chrono::nanoseconds >(
+            std::chrono::system_clock::now().time_since_epoch() ).count();
+
+        /* Continuations first; the first record is published last */
+        for ( size_t i = nRecords; i > 0; --i )
+        {
+            Record&      record = thisState.records[ first + i - 1 ];
+            const size_t offset = ( i - 1 ) * perRecord;
+            const size_t length = std::min( perRecord, size - std::min( size, offset ) );
+
+            record.timestamp = timestamp;
+            record.thread    = threadNumber();
+            record.site      = site;
+            record.level     = (uint8_t) level;
+            record.length    = (uint16_t) length;
+            record.records   = (uint32_t) nRecords;
+
+            memcpy( record.payload, payload + offset, length );
+
+            if ( i > 1 ) record.type = CONTINUATION;
+        }
+
+        std::atomic_thread_fence( std::memory_order_release );
+        thisState.records[ first ].type = (uint8_t) type;
+
+        return true;
+    }
+};
+
+
+#endif /* BINARY_LOG_HPP_ */
@@ -0,0 +1,480 @@
+#ifndef ENTRY_POOL_HPP_
+#define ENTRY_POOL_HPP_
+
+#include <new>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+#include <type_traits>
+#include <memory>
+#include <vector>
+#include "numa_topology.hpp"
+
+
+namespace HashMapTest {
+
+const unsigned int POOL_SLAB_NODES    = 256;    // nodes allocated at once
+const unsigned int POOL_BATCH_NODES   = 32;     // nodes moved between depot and caches
+const unsigned int POOL_CACHE_LIMIT   = 64;     // max nodes cached per thread per pool
+
+/*
+ * Allocators create and destroy hash map entries:
+ *
+ *   template < typename... Args > T* create( Args&&... args );
+ *   void destroy( T* object );
+ *   void setNode( const int node );
+ *
+ * create returns nullptr if out of memory. setNode asks for memory
+ * allocated from then on to be placed on a NUMA node, if possible. Allocators with BULK_RELEASE set
+ * free all of their memory when destroyed, so the owning map only has to
+ * run entry destructors (if any) instead of destroying entries one by one.
+ */
+
+/* Plain new / delete for every entry */
+template < typename T >
+class HeapAllocator
+{
+public:
+    enum { BULK_RELEASE = false };
+
+    template < typename... Args >
+    T* create( Args&&... args )
+    {
+        return new ( std::nothrow ) T( std::forward< Args >( args )... );
+    }
+
+    void destroy( T* object )
+    {
+        delete object;
+    }
+
+    /* Entries share heap pages with anything else; they can't be placed */
+    void setNode( const int node )
+    {
+        ( void ) node;
+    }
+};
+
+/*
+ * Slab pool of fixed size nodes. Nodes are allocated POOL_SLAB_NODES at a
+ * time into a shared depot, and every thread keeps a small cache of free
+ * nodes per pool, so create / destroy only touch the depot (and its mutex)
+ * once every POOL_BATCH_NODES operations. All slabs are freed at once when
+ * the pool is destroyed; nodes left in thread caches go with them.
+ *
+ * After setNode, new slabs are page aligned, padded to whole pages and
+ * bound to the node, so slabs of pools on different nodes never share a
+ * page; slabs allocated before stay where they are.
+ *
+ * Every live pool holds a small slot number, reused after the pool is
+ * destroyed, and a thread keeps one cache per slot, so a thread caches
+ * nodes of every pool it uses (e.g. all shards of a ShardedHashMap) and
+ * finds its cache with one index. A cache is bound to its pool by a
+ * unique id rather than the slot, so caches of threads that outlive a
+ * pool are never reused for the pool that takes its slot next.
+ *
+ * The depot is shared by the pool and the caches filled from it, and has
+ * its own lock; a thread giving back a cache of another pool, on a slot
+ * change or thread exit, only takes that pool's lock, and drops the nodes
+ * if the pool is gone. Only pool construction and destruction take the
+ * process-wide lock of the slot numbers.
+ *
+ * A thread's caches may be destroyed before pools it still uses, e.g. the
+ * main thread's before a global map frees its retired entries at exit;
+ * from then on the thread takes and gives back nodes at the depot directly.
+ */
+template < typename T >
+class PoolAllocator
+{
+public:
+    enum { BULK_RELEASE = true };
+
+    PoolAllocator();
+
+    ~PoolAllocator();
+
+    PoolAllocator( const PoolAllocator& ) = delete;
+    PoolAllocator& operator=( const PoolAllocator& ) = delete;
+
+    template < typename... Args >
+    T* create( Args&&... args );
+
+    void destroy( T* object );
+
+    void setNode( const int node );
+
+    const size_t capacity( void ) const;
+
+private:
+    union Node
+    {
+        Node*                                                           next;
+        typename std::aligned_storage< sizeof( T ), alignof( T ) >::type storage;
+    };
+
+    struct Slab
+    {
+        Slab*   next;
+        bool    isPlaced;   // page aligned and bound to a node
+        Node    nodes[ POOL_SLAB_NODES ];
+    };
+
+    /* Free nodes of a pool; outlives the pool while threads cache its nodes */
+    struct Depot
+    {
+        std::mutex  mutex;      // guards head, isAlive and the pool's slabs
+        Node*       head;
+        bool        isAlive;    // false once the pool freed its slabs
+    };
+
+    struct CacheEntry
+    {
+        uint64_t                    poolId;
+        std::shared_ptr< Depot >    depot;
+        Node*                       head;
+        size_t                      count;
+    };
+
+    struct ThreadCache
+    {
+        std::vector< CacheEntry >   entries;    // by pool slot
+
+        ~ThreadCache();
+    };
+
+    struct Slots
+    {
+        std::mutex              mutex;
+        std::vector< size_t >   free;
+        size_t                  count;
+    };
+
+    static Slots&       slots      ( void );
+    static ThreadCache& threadCache( void );
+    static bool&        isCacheGone( void );
+    static uint64_t     nextPoolId ( void );
+
+    static void release( CacheEntry& entry );
+
+    CacheEntry& cacheEntry( void );
+
+    void refill( CacheEntry& entry );
+    void flush ( CacheEntry& entry, size_t count );
+
+    Slab* newSlab   ( void );
+    void  deleteSlab( Slab* slab );
+
+    const uint64_t              _id;
+    size_t                      _slot;      // index of this pool's thread caches
+    std::shared_ptr< Depot >    _depot;
+    Slab*                       _slabs;
+    std::atomic< size_t >       _nSlabs;
+    int                         _node;      // NUMA node of new slabs
+};
+
+template < typename T >
+PoolAllocator<T>::PoolAllocator() : _id{ nextPoolId() }, _slot{ 0 }, _depot{ std::make_shared< Depot >() },
+    _slabs{ nullptr }, _nSlabs{ 0 }, _node{ NUMA_NO_NODE }
+{
+    _depot->head    = nullptr;
+    _depot->isAlive = true;
+
+    Slots& pools = slots();
+
+    std::lock_guard< std::mutex > lock( pools.mutex );
+
+    if ( pools.free.empty() )
+    {
+        _slot = pools.count++;
+    }
+    else
+    {
+        _slot = pools.free.back();
+        pools.free.pop_back();
+    }
+}
+
+template < typename T >
+PoolAllocator<T>::~PoolAllocator()
+{
+    /* Stop other threads from flushing their caches into this pool */
+    {
+        std::lock_guard< std::mutex > lock( _depot->mutex );
+
+        _depot->isAlive = false;
+        _depot->head    = nullptr;
+    }
+
+    /* Free all slabs at once; nodes still cached by threads are dropped */
+    while ( _slabs )
+    {
+        Slab* slab = _slabs;
+        _slabs = _slabs->next;
+        deleteSlab( slab );
+    }
+
+    Slots& pools = slots();
+
+    std::lock_guard< std::mutex > lock( pools.mutex );
+    pools.free.push_back( _slot );
+}
+
+template < typename T >
+template < typename... Args >
+T* PoolAllocator<T>::create( Args&&... args )
+{
+    /* Thread is exiting; take a batch for this node only */
+    if ( isCacheGone() )
+    {
+        CacheEntry entry{ _id, _depot, nullptr, 0 };
+
+        refill( entry );
+        if ( !entry.head ) return nullptr;
+
+        Node* node = entry.head;
+        entry.head = node->next;
+        release( entry );
+
+        return new ( &node->storage ) T( std::forward< Args >( args )... );
+    }
+
+    CacheEntry& entry = cacheEntry();
+
+    /* Take a batch of nodes from depot when cache is empty */
+    if ( !entry.head ) refill( entry );
+    if ( !entry.head ) return nullptr;
+
+    Node* node = entry.head;
+    entry.head = node->next;
+    entry.count--;
+
+    return new ( &node->storage ) T( std::forward< Args >( args )... );
+}
+
+template < typename T >
+void PoolAllocator<T>::destroy( T* object )
+{
+    object->~T();
+
+    Node* node = reinterpret_cast< Node* >( object );
+
+    /* Thread is exiting; give the node straight back to depot */
+    if ( isCacheGone() )
+    {
+        std::lock_guard< std::mutex > lock( _depot->mutex );
+
+        node->next   = _depot->head;
+        _depot->head = node;
+
+        return;
+    }
+
+    CacheEntry& entry = cacheEntry();
+
+    node->next = entry.head;
+    entry.head = node;
+    entry.count++;
+
+    /* Give a batch of nodes back to depot when cache is full */
+    if ( entry.count > POOL_CACHE_LIMIT ) flush( entry, POOL_BATCH_NODES );
+}
+
+template < typename T >
+void PoolAllocator<T>::setNode( const int node )
+{
+    std::lock_guard< std::mutex > lock( _depot->mutex );
+    _node = node;
+}
+
+template < typename T >
+const size_t PoolAllocator<T>::capacity( void ) const
+{
+    return _nSlabs * POOL_SLAB_NODES;
+}
+
+template < typename T >
+PoolAllocator<T>::ThreadCache::~ThreadCache()
+{
+    /* Pools used later on this thread go to their depots directly */
+    isCacheGone() = true;
+
+    /* Give cached nodes back to pools that are still alive */
+    for ( auto& entry : entries ) release( entry );
+}
+
+template < typename T >
+typename PoolAllocator<T>::Slots& PoolAllocator<T>::slots( void )
+{
+    static Slots pools{ {}, {}, 0 };
+    return pools;
+}
+
+template < typename T >
+typename PoolAllocator<T>::ThreadCache& PoolAllocator<T>::threadCache( void )
+{
+    static thread_local ThreadCache cache{};
+    return cache;
+}
+
+template < typename T >
+bool& PoolAllocator<T>::isCacheGone( void )
+{
+    /* Trivially destructible, so still readable after the cache is destroyed */
+    static thread_local bool isGone = false;
+    return isGone;
+}
+
+template < typename T >
+uint64_t PoolAllocator<T>::nextPoolId( void )
+{
+    static std::atomic< uint64_t > lastId{ 0 };
+    return ++lastId;
+}
+
+template < typename T >
+void PoolAllocator<T>::release( CacheEntry& entry )
+{
+    if ( entry.head )
+    {
+        std::lock_guard< std::mutex > lock( entry.depot->mutex );
+
+        /* Nodes of a destroyed pool were freed along with its slabs */
+        if ( entry.depot->isAlive )
+        {
+            Node* last = entry.head;
+            while ( last->next ) last = last->next;
+
+            last->next         = entry.depot->head;
+            entry.depot->head  = entry.head;
+        }
+    }
+
+    entry = CacheEntry{ 0, nullptr, nullptr, 0 };
+}
+
+template < typename T >
+typename PoolAllocator<T>::CacheEntry& PoolAllocator<T>::cacheEntry( void )
+{
+    ThreadCache& cache = threadCache();
+
+    if ( _slot < cache.entries.size() && cache.entries[ _slot ].poolId == _id ) return cache.entries[ _slot ];
+
+    /* First use of this pool by the thread; the slot may hold a cache of a destroyed pool */
+    if ( _slot >= cache.entries.size() ) cache.entries.resize( _slot + 1, CacheEntry{ 0, nullptr, nullptr, 0 } );
+
+    CacheEntry& entry = cache.entries[ _slot ];
+
+    release( entry );
+
+    entry.poolId = _id;
+    entry.depot  = _depot;
+
+    return entry;
+}
+
+template < typename T >
+void PoolAllocator<T>::refill( CacheEntry& entry )
+{
+    Depot& depot = *_depot;
+
+    std::lock_guard< std::mutex > lock( depot.mutex );
+
+    /* Carve a new slab into the depot when it runs dry */
+    if ( !depot.head )
+    {
+        Slab* slab = newSlab();
+        if ( !slab ) return;
+
+        for ( size_t i = 0; i < POOL_SLAB_NODES; ++i )
+        {
+            slab->nodes[ i ].next = ( i + 1 < POOL_SLAB_NODES ) ? &slab->nodes[ i + 1 ] : nullptr;
+        }
+
+        depot.head  = &slab->nodes[ 0 ];
+        slab->next  = _slabs;
+        _slabs      = slab;
+        _nSlabs++;
+    }
+
+    /* Move a batch of nodes from depot to cache */
+    for ( size_t i = 0; i < POOL_BATCH_NODES && depot.head; ++i )
+    {
+        Node* node = depot.head;
+        depot.head = node->next;
+        node->next = entry.head;
+        entry.head = node;
+        entry.count++;
+    }
+}
+
+template < typename T >
+typename PoolAllocator<T>::Slab* PoolAllocator<T>::newSlab( void )
+{
+    /* Caller must hold the depot's mutex */
+    if ( _node == NUMA_NO_NODE )
+    {
+        Slab* slab = new ( std::nothrow ) Slab;
+        if ( slab ) slab->isPlaced = false;
+
+        return slab;
+    }
+
+    /* Whole pages of its own, so binding doesn't move other memory */
+    const size_t page   = NumaTopology::pageSize();
+    const size_t length = ( sizeof( Slab ) + page - 1 ) & ~( page - 1 );
+    void*        memory = nullptr;
+
+    if ( posix_memalign( &memory, page, length ) != 0 ) return nullptr;
+
+    NumaTopology::bindMemory( memory, length, _node );
+
+    Slab* slab = new ( memory ) Slab;
+    slab->isPlaced = true;
+
+    return slab;
+}
+
+template < typename T >
+void PoolAllocator<T>::deleteSlab( Slab* slab )
+{
+    if ( slab->isPlaced )
+    {
+        free( slab );
+    }
+    else
+    {
+        delete slab;
+    }
+}
+
+template < typename T >
+void PoolAllocator<T>::flush( CacheEntry& entry, size_t count )
+{
+    if ( count == 0 || !entry.head ) return;
+
+    /* Detach count nodes from the front of the cache */
+    Node*  first = entry.head;
+    Node*  last  = first;
+    size_t moved = 1;
+
+    while ( moved < count && last->next )
+    {
+        last = last->next;
+        moved++;
+    }
+
+    entry.head   = last->next;
+    entry.count -= moved;
+
+    std::lock_guard< std::mutex > lock( _depot->mutex );
+
+    last->next   = _depot->head;
+    _depot->head = first;
+}
+
+} // HashMapTest
+
+
+#endif /* ENTRY_POOL_HPP_ */
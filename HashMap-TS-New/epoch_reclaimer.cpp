@@ -0,0 +1,270 @@
+#include <algorithm>
+#include "epoch_reclaimer.hpp"
+
+
+namespace HashMapTest {
+
+using std::lock_guard;
+using std::memory_order_relaxed;
+using std::memory_order_acquire;
+using std::memory_order_release;
+
+const uint64_t EpochReclaimer::QUIESCENT;
+
+EpochReclaimer::EpochReclaimer() : _id{ nextId() }, _epoch{ 0 }, _records{ nullptr }
+{
+    Registry& reclaimers = registry();
+
+    lock_guard< std::mutex > lock( reclaimers.mutex );
+    reclaimers.reclaimers[ _id ] = this;
+}
+
+EpochReclaimer::~EpochReclaimer()
+{
+    /* Stop exiting threads from releasing their records */
+    {
+        Registry& reclaimers = registry();
+
+        lock_guard< std::mutex > lock( reclaimers.mutex );
+        reclaimers.reclaimers.erase( _id );
+    }
+
+    /* No reader is left; free everything that is still retired */
+    ThreadRecord* record = _records.load();
+    while ( record )
+    {
+        for ( const Retired& retired : record->retired )
+        {
+            retired.deleter( retired.context, retired.object );
+        }
+
+        ThreadRecord* next = record->next;
+        delete record;
+        record = next;
+    }
+}
+
+void EpochReclaimer::enter( void )
+{
+    ThreadRecord& thisRecord = record();
+
+    /* Pin current epoch; must be visible before any shared pointer is read */
+    if ( thisRecord.nesting++ == 0 )
+    {
+        thisRecord.epoch.store( _epoch.load() );
+    }
+}
+
+void EpochReclaimer::leave( void )
+{
+    ThreadRecord& thisRecord = record();
+
+    if ( --thisRecord.nesting == 0 )
+    {
+        thisRecord.epoch.store( QUIESCENT, memory_order_release );
+    }
+}
+
+void EpochReclaimer::retire( void* object, Deleter deleter, void* context )
+{
+    ThreadRecord& thisRecord = record();
+
+    /* Caller has unlinked object already; readers of this epoch may still hold it */
+    thisRecord.retired.push_back( Retired{ object, deleter, context, _epoch.load() } );
+
+    const uint64_t nRetired = thisRecord.nRetired.load( memory_order_relaxed ) + 1;
+    thisRecord.nRetired.store( nRetired, memory_order_relaxed );
+
+    /* Collect in batches */
+    if ( nRetired % EPOCH_RETIRE_BATCH == 0 ) collect();
+}
+
+void EpochReclaimer::collect( void )
+{
+    tryAdvance();
+    reclaim( record() );
+
+    /* Records of exited threads have nobody else to collect them */
+    for ( ThreadRecord* record = _records.load( memory_order_acquire ); record; record = record->next )
+    {
+        bool isInUse = false;
+        if ( record->inUse.load( memory_order_relaxed ) ||
+             !record->inUse.compare_exchange_strong( isInUse, true, memory_order_acquire ) )
+        {
+            continue;
+        }
+
+        reclaim( *record );
+        record->inUse.store( false, memory_order_release );
+    }
+}
+
+EpochReclaimer::Stats EpochReclaimer::stats( void ) const
+{
+    Stats stats{};
+
+    stats.epoch = _epoch.load( memory_order_relaxed );
+
+    for ( ThreadRecord* record = _records.load( memory_order_acquire ); record; record = record->next )
+    {
+        stats.retired += record->nRetired.load( memory_order_relaxed );
+        stats.freed   += record->nFreed.load( memory_order_relaxed );
+        stats.threads++;
+    }
+
+    stats.pending = stats.retired - stats.freed;
+
+    return stats;
+}
+
+EpochReclaimer::ThreadCache::~ThreadCache()
+{
+    /* Give records back to reclaimers that are still alive */
+    for ( const auto& entry : entries ) release( entry );
+}
+
+EpochReclaimer::Registry& EpochReclaimer::registry( void )
+{
+    static Registry reclaimers;
+    return reclaimers;
+}
+
+EpochReclaimer::ThreadCache& EpochReclaimer::threadCache( void )
+{
+    static thread_local ThreadCache cache{};
+    return cache;
+}
+
+uint64_t EpochReclaimer::nextId( void )
+{
+    static std::atomic< uint64_t > lastId{ 0 };
+    return ++lastId;
+}
+
+void EpochReclaimer::release( const CacheEntry& entry )
+{
+    Registry& reclaimers = registry();
+
+    lock_guard< std::mutex > lock( reclaimers.mutex );
+
+    /* Records of a destroyed reclaimer were freed along with it */
+    const auto it = reclaimers.reclaimers.find( entry.reclaimerId );
+    if ( it == reclaimers.reclaimers.end() ) return;
+
+    /*
+     * Nobody collects this record until another thread does; free what is
+     * safe now. The exiting thread pins nothing, so the epoch may move on
+     * twice (here or by others), enough for all of its objects if no reader
+     * is behind.
+     */
+    EpochReclaimer& reclaimer = *it->second;
+
+    reclaimer.tryAdvance();
+    reclaimer.tryAdvance();
+    reclaimer.reclaim( *entry.record );
+
+    entry.record->inUse.store( false, memory_order_release );
+}
+
+EpochReclaimer::ThreadRecord& EpochReclaimer::record( void )
+{
+    ThreadCache& cache = threadCache();
+
+    /* Most threads use one map at a time */
+    if ( cache.last < cache.entries.size() && cache.entries[ cache.last ].reclaimerId == _id )
+    {
+        return *cache.entries[ cache.last ].record;
+    }
+
+    for ( size_t i = 0; i < cache.entries.size(); ++i )
+    {
+        if ( cache.entries[ i ].reclaimerId == _id )
+        {
+            cache.last = i;
+            return *cache.entries[ i ].record;
+        }
+    }
+
+    /* First use by this thread; forget reclaimers that are gone */
+    {
+        Registry& reclaimers = registry();
+
+        lock_guard< std::mutex > lock( reclaimers.mutex );
+
+        cache.entries.erase( std::remove_if( cache.entries.begin(), cache.entries.end(),
+                                             [ &reclaimers ]( const CacheEntry& entry )
+                                             {
+                                                 return !reclaimers.reclaimers.count( entry.reclaimerId );
+                                             } ),
+                             cache.entries.end() );
+    }
+
+    cache.entries.push_back( CacheEntry{ _id, acquire() } );
+    cache.last = cache.entries.size() - 1;
+
+    return *cache.entries[ cache.last ].record;
+}
+
+EpochReclaimer::ThreadRecord* EpochReclaimer::acquire( void )
+{
+    /* Reuse a record of an exited thread, along with its retired objects */
+    for ( ThreadRecord* record = _records.load( memory_order_acquire ); record; record = record->next )
+    {
+        bool isInUse = false;
+        if ( !record->inUse.load( memory_order_relaxed ) &&
+             record->inUse.compare_exchange_strong( isInUse, true, memory_order_acquire ) )
+        {
+            return record;
+        }
+    }
+
+    ThreadRecord* record = new ThreadRecord();
+
+    record->epoch    = QUIESCENT;
+    record->inUse    = true;
+    record->nRetired = 0;
+    record->nFreed   = 0;
+    record->nesting  = 0;
+    record->next     = _records.load( memory_order_relaxed );
+
+    while ( !_records.compare_exchange_weak( record->next, record, memory_order_release, memory_order_relaxed ) );
+
+    return record;
+}
+
+bool EpochReclaimer::tryAdvance( void )
+{
+    uint64_t epoch = _epoch.load();
+
+    /* Every thread in a critical section must have seen current epoch */
+    for ( ThreadRecord* record = _records.load( memory_order_acquire ); record; record = record->next )
+    {
+        const uint64_t pinned = record->epoch.load();
+        if ( pinned != QUIESCENT && pinned != epoch ) return false;
+    }
+
+    return _epoch.compare_exchange_strong( epoch, epoch + 1 );
+}
+
+void EpochReclaimer::reclaim( ThreadRecord& record )
+{
+    /* Readers may hold objects retired in the previous epoch, but none older */
+    const uint64_t epoch = _epoch.load();
+
+    auto isSafe = [ epoch ]( const Retired& retired ) { return ( retired.epoch + 2 <= epoch ); };
+
+    auto kept = std::stable_partition( record.retired.begin(), record.retired.end(),
+                                       [ &isSafe ]( const Retired& retired ) { return !isSafe( retired ); } );
+
+    for ( auto it = kept; it != record.retired.end(); ++it )
+    {
+        it->deleter( it->context, it->object );
+    }
+
+    const uint64_t nFreed = record.nFreed.load( memory_order_relaxed ) + ( record.retired.end() - kept );
+    record.nFreed.store( nFreed, memory_order_relaxed );
+
+    record.retired.erase( kept, record.retired.end() );
+}
+
+} // HashMapTest
@@ -0,0 +1,141 @@
+#ifndef EPOCH_RECLAIMER_HPP_
+#define EPOCH_RECLAIMER_HPP_
+
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+
+namespace HashMapTest {
+
+const unsigned int EPOCH_RETIRE_BATCH   = 64;   // retired objects per thread before collecting
+const unsigned int EPOCH_RECORD_PADDING = 64;   // cache line size
+
+/*
+ * Epoch based reclamation. Readers that follow pointers without a lock
+ * enter a critical section (see Guard), which pins the global epoch they
+ * started in. Writers unlink an object first and then retire it; the
+ * object is freed once the epoch has moved on twice, when no reader can
+ * still hold it.
+ *
+ * Every thread gets a record per reclaimer on first use, which carries
+ * its pinned epoch and its own list of retired objects, so neither
+ * entering nor retiring touches shared state beyond the global epoch.
+ * Each list is collected by its thread every EPOCH_RETIRE_BATCH retires:
+ * the epoch is advanced if all pinned threads have caught up, and objects
+ * retired two epochs ago are freed in one batch. A thread collects its
+ * record once more when it exits; what is left is collected by the others,
+ * and the record is reused by new threads.
+ *
+ * Objects still retired when the reclaimer is destroyed are freed by its
+ * destructor; no thread may be in a critical section by then.
+ */
+class EpochReclaimer
+{
+public:
+    typedef void ( *Deleter )( void* context, void* object );
+
+    struct Stats
+    {
+        uint64_t    epoch;          // global epoch
+        uint64_t    retired;        // objects retired so far
+        uint64_t    freed;          // objects freed so far
+        uint64_t    pending;        // objects retired but not freed yet
+        uint64_t    threads;        // thread records
+    };
+
+    /* Critical section of the calling thread for its lifetime */
+    class Guard
+    {
+    public:
+        Guard( EpochReclaimer& reclaimer ) : _reclaimer( reclaimer ) { _reclaimer.enter(); }
+        ~Guard()                                                     { _reclaimer.leave(); }
+
+        Guard( const Guard& ) = delete;
+        Guard& operator=( const Guard& ) = delete;
+
+    private:
+        EpochReclaimer& _reclaimer;
+    };
+
+    EpochReclaimer();
+
+    ~EpochReclaimer();
+
+    EpochReclaimer( const EpochReclaimer& ) = delete;
+    EpochReclaimer& operator=( const EpochReclaimer& ) = delete;
+
+    void enter( void );
+    void leave( void );
+
+    void retire ( void* object, Deleter deleter, void* context );
+    void collect( void );
+
+    Stats stats( void ) const;
+
+private:
+    struct Retired
+    {
+        void*       object;
+        Deleter     deleter;
+        void*       context;
+        uint64_t    epoch;          // global epoch when retired
+    };
+
+    struct ThreadRecord
+    {
+        std::atomic< uint64_t >     epoch;      // pinned epoch, QUIESCENT outside critical sections
+        std::atomic< bool >         inUse;      // owned by a thread
+        std::atomic< uint64_t >     nRetired;   // written by owner only
+        std::atomic< uint64_t >     nFreed;     // written by owner only
+        size_t                      nesting;    // critical sections entered by owner
+        std::vector< Retired >      retired;    // owner's retired objects
+        ThreadRecord*               next;
+        char                        padding[ EPOCH_RECORD_PADDING ];
+    };
+
+    struct CacheEntry
+    {
+        uint64_t        reclaimerId;
+        ThreadRecord*   record;
+    };
+
+    struct ThreadCache
+    {
+        std::vector< CacheEntry >   entries;
+        size_t                      last;       // most recently used entry
+
+        ~ThreadCache();
+    };
+
+    struct Registry
+    {
+        std::mutex                                          mutex;
+        std::unordered_map< uint64_t, EpochReclaimer* >     reclaimers;
+    };
+
+    static const uint64_t QUIESCENT = ~(uint64_t) 0;
+
+    static Registry&    registry   ( void );
+    static ThreadCache& threadCache( void );
+    static uint64_t     nextId     ( void );
+
+    static void release( const CacheEntry& entry );
+
+    ThreadRecord& record   ( void );
+    ThreadRecord* acquire  ( void );
+    bool          tryAdvance( void );
+
+    void reclaim( ThreadRecord& record );
+
+    const uint64_t                  _id;
+    std::atomic< uint64_t >         _epoch;
+    std::atomic< ThreadRecord* >    _records;   // push only; freed by destructor
+};
+
+} // HashMapTest
+
+
+#endif /* EPOCH_RECLAIMER_HPP_ */
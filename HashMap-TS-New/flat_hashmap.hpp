@@ -0,0 +1,582 @@
+#ifndef FLAT_HASHMAP_HPP_
+#define FLAT_HASHMAP_HPP_
+
+#include <new>
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+#include "logger.hpp"
+#include "hashmap.hpp"
+#include "probe_group.hpp"
+#include "read_write_lock.hpp"
+
+
+namespace HashMapTest {
+
+const float DEFAULT_FLAT_MAX_LOAD_FACTOR = 0.875f;
+
+/*
+ * Open addressing hash table without any locking; keys and values are
+ * stored inline in a single slot array, next to an array of one control
+ * byte per slot. A control byte is either empty, deleted or the 7-bit tag
+ * of the key in that slot, taken from the hash bits just above the slot
+ * index. Lookups probe a group of G::WIDTH control bytes at a time from the
+ * home slot, compare keys only on matching tags, and stop at the first
+ * group with an empty slot. The first G::WIDTH control bytes are cloned
+ * past the end, so a group never wraps around.
+ *
+ * Deleted slots leave a tombstone unless no probe window around them was
+ * ever full. The table is rehashed when live entries plus tombstones exceed
+ * size * maxLoadFactor; it doubles if live entries take more than half of
+ * that, otherwise it is only purged of tombstones. It halves (but never
+ * below its initial size) when length drops under size * minLoadFactor.
+ */
+template < typename K, typename V, typename F = DefaultHashFunction< K >, typename G = DefaultProbeGroup >
+class FlatTable
+{
+public:
+    FlatTable( const size_t size,
+               const float  maxLoadFactor = DEFAULT_FLAT_MAX_LOAD_FACTOR,
+               const float  minLoadFactor = DEFAULT_MIN_LOAD_FACTOR );
+
+    ~FlatTable();
+
+    FlatTable( const FlatTable& ) = delete;
+    FlatTable& operator=( const FlatTable& ) = delete;
+
+    bool     add ( const K& key, const V& value );
+    bool     del ( const K& key );
+    const V* find( const K& key ) const;
+
+    const size_t size  ( void ) const;
+    const size_t length( void ) const;
+
+    const float maxLoadFactor( void ) const;
+    const float minLoadFactor( void ) const;
+
+    bool resize( const size_t size );
+
+    template < typename Function >
+    void forEach( Function function ) const;
+
+private:
+    struct Slot
+    {
+        K   key;
+        V   value;
+    };
+
+    typedef typename std::aligned_storage< sizeof( Slot ), alignof( Slot ) >::type SlotStorage;
+
+    Slot&       slotAt( const size_t index );
+    const Slot& slotAt( const size_t index ) const;
+
+    int8_t tagOf     ( const HashType hash ) const;
+    void   setControl( const size_t index, const int8_t control );
+
+    size_t findSlot  ( const K& key, const HashType hash ) const;
+    size_t insertSlot( const HashType hash ) const;
+
+    bool rehash( const size_t size );
+
+    int8_t*         _control;
+    SlotStorage*    _slots;
+    F               _hashFunction;
+    size_t          _size;
+    size_t          _shift;
+    size_t          _minSize;
+    size_t          _length;
+    size_t          _deleted;
+    float           _maxLoadFactor;
+    float           _minLoadFactor;
+};
+
+template < typename K, typename V, typename F, typename G >
+FlatTable<K, V, F, G>::FlatTable( const size_t size, const float maxLoadFactor, const float minLoadFactor ) :
+    _control{ nullptr }, _slots{ nullptr }, _size{ 0 }, _shift{ 0 }, _minSize{ 0 },
+    _length{ 0 }, _deleted{ 0 }, _maxLoadFactor{ maxLoadFactor }, _minLoadFactor{ minLoadFactor }
+{
+    /* Validate max load factor; at least one slot must always stay empty */
+    if ( maxLoadFactor <= 0 || maxLoadFactor >= 1 )
+    {
+        _maxLoadFactor = DEFAULT_FLAT_MAX_LOAD_FACTOR;
+    }
+
+    /* Keep shrink threshold well below growth threshold to avoid thrashing */
+    if ( minLoadFactor < 0 || minLoadFactor > _maxLoadFactor / 4 )
+    {
+        _minLoadFactor = _maxLoadFactor / 4;
+    }
+
+    /* Validate positive size; use default size otherwise. Must hold a group */
+    _minSize = roundUpToPowerOfTwo( std::max< size_t >( size > 0 ? size : DEFAULT_HASHMAP_SIZE, G::WIDTH ) );
+
+    /* Allocate control bytes and slots */
+    if ( !rehash( _minSize ) )
+    {
+        LOG_ERR() << "Could not allocate memory for HashMap! Exiting..." << endl;
+
+        std::exit( EXIT_FAILURE );
+    }
+}
+
+template < typename K, typename V, typename F, typename G >
+FlatTable<K, V, F, G>::~FlatTable()
+{
+    /* Destroy entries in occupied slots */
+    for ( size_t i = 0; i < _size; ++i )
+    {
+        if ( _control[ i ] >= 0 ) slotAt( i ).~Slot();
+    }
+
+    delete [] _control;
+    delete [] _slots;
+
+    _control = nullptr;
+    _slots   = nullptr;
+    _length  = 0;
+}
+
+template < typename K, typename V, typename F, typename G >
+bool FlatTable<K, V, F, G>::add( const K& key, const V& value )
+{
+    /* Calculate hash value for new entry */
+    const HashType hash = _hashFunction( key );
+
+    /* Update value if entry already exists */
+    size_t index = findSlot( key, hash );
+    if ( index < _size )
+    {
+        slotAt( index ).value = value;
+        return true;
+    }
+
+    /* Make room before taking another slot */
+    if ( _length + _deleted + 1 > _size * _maxLoadFactor )
+    {
+        const size_t newSize = ( _length + 1 > _size * _maxLoadFactor / 2 ) ? ( _size << 1 ) : _size;
+
+        if ( !rehash( newSize ) ) return false;
+    }
+
+    /* Take the first free slot on probe sequence */
+    index = insertSlot( hash );
+
+    if ( _control[ index ] == CONTROL_DELETED ) --_deleted;
+
+    new ( &_slots[ index ] ) Slot{ key, value };
+    setControl( index, tagOf( hash ) );
+
+    /* Increment length of hash map */
+    _length++;
+
+    return true;
+}
+
+template < typename K, typename V, typename F, typename G >
+bool FlatTable<K, V, F, G>::del( const K& key )
+{
+    const size_t mask = _size - 1;
+
+    /* Find slot of the entry */
+    const size_t index = findSlot( key, _hashFunction( key ) );
+
+    /* If entry not found, return false */
+    if ( index >= _size ) return false;
+
+    slotAt( index ).~Slot();
+
+    /*
+     * A probe only moves past a group without empty slots. If the empty
+     * slots around this one are less than a group apart, no such group ever
+     * covered it, and it can be made empty instead of deleted.
+     */
+    const uint32_t emptyBefore = G( &_control[ ( index - G::WIDTH ) & mask ] ).matchEmpty();
+    const uint32_t emptyAfter  = G( &_control[ index ] ).matchEmpty();
+
+    const bool isNeverFull = emptyBefore && emptyAfter &&
+        ( lowestBit( emptyAfter ) + ( G::WIDTH - 1 - highestBit( emptyBefore ) ) ) < G::WIDTH;
+
+    if ( isNeverFull )
+    {
+        setControl( index, CONTROL_EMPTY );
+    }
+    else
+    {
+        setControl( index, CONTROL_DELETED );
+        ++_deleted;
+    }
+
+    /* Decrement length of hash map */
+    _length--;
+
+    /* Halve the size when too sparse, but not below the initial size */
+    if ( _size > _minSize && _length < _size * _minLoadFactor )
+    {
+        rehash( _size >> 1 );
+    }
+
+    return true;
+}
+
+template < typename K, typename V, typename F, typename G >
+const V* FlatTable<K, V, F, G>::find( const K& key ) const
+{
+    const size_t index = findSlot( key, _hashFunction( key ) );
+
+    return ( index < _size ) ? &slotAt( index ).value : nullptr;
+}
+
+template < typename K, typename V, typename F, typename G >
+const size_t FlatTable<K, V, F, G>::size( void ) const
+{
+    return _size;
+}
+
+template < typename K, typename V, typename F, typename G >
+const size_t FlatTable<K, V, F, G>::length( void ) const
+{
+    return _length;
+}
+
+template < typename K, typename V, typename F, typename G >
+const float FlatTable<K, V, F, G>::maxLoadFactor( void ) const
+{
+    return _maxLoadFactor;
+}
+
+template < typename K, typename V, typename F, typename G >
+const float FlatTable<K, V, F, G>::minLoadFactor( void ) const
+{
+    return _minLoadFactor;
+}
+
+template < typename K, typename V, typename F, typename G >
+bool FlatTable<K, V, F, G>::resize( const size_t size )
+{
+    const size_t newSize = roundUpToPowerOfTwo( std::max< size_t >( size, G::WIDTH ) );
+
+    /* Validate new size; all entries must fit under max load factor */
+    if ( newSize == _size || _length + 1 > newSize * _maxLoadFactor )
+    {
+        LOG_ERR() << "Cannot resize! New size must differ from old size and fit all entries!" << endl;
+
+        return false;
+    }
+
+    return rehash( newSize );
+}
+
+template < typename K, typename V, typename F, typename G >
+template < typename Function >
+void FlatTable<K, V, F, G>::forEach( Function function ) const
+{
+    for ( size_t i = 0; i < _size; ++i )
+    {
+        if ( _control[ i ] >= 0 ) function( slotAt( i ).key, slotAt( i ).value );
+    }
+}
+
+template < typename K, typename V, typename F, typename G >
+typename FlatTable<K, V, F, G>::Slot& FlatTable<K, V, F, G>::slotAt( const size_t index )
+{
+    return *reinterpret_cast< Slot* >( &_slots[ index ] );
+}
+
+template < typename K, typename V, typename F, typename G >
+const typename FlatTable<K, V, F, G>::Slot& FlatTable<K, V, F, G>::slotAt( const size_t index ) const
+{
+    return *reinterpret_cast< const Slot* >( &_slots[ index ] );
+}
+
+template < typename K, typename V, typename F, typename G >
+int8_t FlatTable<K, V, F, G>::tagOf( const HashType hash ) const
+{
+    /* Bits above the slot index tell apart keys sharing a home slot */
+    return (int8_t) ( ( (uint64_t) hash >> _shift ) & 0x7F );
+}
+
+template < typename K, typename V, typename F, typename G >
+void FlatTable<K, V, F, G>::setControl( const size_t index, const int8_t control )
+{
+    _control[ index ] = control;
+
+    /* Keep the clone of the first group in sync */
+    if ( index < G::WIDTH ) _control[ _size + index ] = control;
+}
+
+template < typename K, typename V, typename F, typename G >
+size_t FlatTable<K, V, F, G>::findSlot( const K& key, const HashType hash ) const
+{
+    const size_t mask = _size - 1;
+    const int8_t tag  = tagOf( hash );
+
+    /* Probe group by group from home slot until a group has an empty slot */
+    for ( size_t position = hash & mask; ; position = ( position + G::WIDTH ) & mask )
+    {
+        const G group( &_control[ position ] );
+
+        for ( uint32_t bits = group.match( tag ); bits != 0; bits &= ( bits - 1 ) )
+        {
+            const size_t index = ( position + lowestBit( bits ) ) & mask;
+            if ( slotAt( index ).key == key ) return index;
+        }
+
+        /* Not found */
+        if ( group.matchEmpty() ) return _size;
+    }
+}
+
+template < typename K, typename V, typename F, typename G >
+size_t FlatTable<K, V, F, G>::insertSlot( const HashType hash ) const
+{
+    const size_t mask = _size - 1;
+
+    /* First empty or deleted slot on probe sequence */
+    for ( size_t position = hash & mask; ; position = ( position + G::WIDTH ) & mask )
+    {
+        const uint32_t bits = G( &_control[ position ] ).matchEmptyOrDeleted();
+        if ( bits != 0 ) return ( position + lowestBit( bits ) ) & mask;
+    }
+}
+
+template < typename K, typename V, typename F, typename G >
+bool FlatTable<K, V, F, G>::rehash( const size_t size )
+{
+    /* Allocate memory for new control bytes (and their clones) and slots */
+    int8_t*      newControl = new ( std::nothrow ) int8_t[ size + G::WIDTH ];
+    SlotStorage* newSlots   = new ( std::nothrow ) SlotStorage[ size ];
+    if ( newControl == nullptr || newSlots == nullptr )
+    {
+        delete [] newControl;
+        delete [] newSlots;
+
+        LOG_ERR() << "Could not allocate memory for resizing! Returning..." << endl;
+
+        return false;
+    }
+
+    for ( size_t i = 0; i < size + G::WIDTH; ++i ) newControl[ i ] = CONTROL_EMPTY;
+
+    int8_t*      oldControl = _control;
+    SlotStorage* oldSlots   = _slots;
+    const size_t oldSize    = _size;
+
+    _control = newControl;
+    _slots   = newSlots;
+    _size    = size;
+    _deleted = 0;
+
+    /* Find log2 of size for tags */
+    for ( _shift = 0; ( (size_t) 1 << _shift ) < size; ++_shift );
+
+    /* Move entries from old slots; tombstones are dropped */
+    for ( size_t i = 0; i < oldSize; ++i )
+    {
+        if ( oldControl[ i ] < 0 ) continue;
+
+        Slot& oldSlot = *reinterpret_cast< Slot* >( &oldSlots[ i ] );
+
+        const HashType hash  = _hashFunction( oldSlot.key );
+        const size_t   index = insertSlot( hash );
+
+        new ( &_slots[ index ] ) Slot( std::move( oldSlot ) );
+        setControl( index, tagOf( hash ) );
+
+        oldSlot.~Slot();
+    }
+
+    delete [] oldControl;
+    delete [] oldSlots;
+
+    return true;
+}
+
+/*
+ * Thread-safe wrapper of FlatTable with the API of TSHashMap; a single
+ * ReadWriteLock guards the table like the original map.
+ */
+template < typename K, typename V, typename F = DefaultHashFunction< K >, typename G = DefaultProbeGroup >
+class TSFlatHashMap
+{
+public:
+    TSFlatHashMap( const size_t size,
+                   const float  maxLoadFactor = DEFAULT_FLAT_MAX_LOAD_FACTOR,
+                   const float  minLoadFactor = DEFAULT_MIN_LOAD_FACTOR );
+
+    ~TSFlatHashMap();
+
+    bool add ( const K& key, const V& value );
+    bool del ( const K& key );
+    bool find( const K& key, V& value );
+
+    const size_t size  ( void ) const;
+    const size_t length( void ) const;
+
+    const float loadFactor   ( void ) const;
+    const float maxLoadFactor( void ) const;
+    const float minLoadFactor( void ) const;
+
+    bool resize( const size_t size );
+
+    void                 setLockPolicy ( const ReadWriteLock::Policy policy );
+    ReadWriteLock::Stats lockStats     ( void ) const;
+    void                 resetLockStats( void );
+
+    void print( void );
+
+private:
+    void updateCounters( void );
+
+    FlatTable< K, V, F, G > _table;
+    std::atomic< size_t >   _size;
+    std::atomic< size_t >   _length;
+    ReadWriteLock           _mutex;
+};
+
+template < typename K, typename V, typename F, typename G >
+TSFlatHashMap<K, V, F, G>::TSFlatHashMap( const size_t size,
+                                          const float  maxLoadFactor,
+                                          const float  minLoadFactor ) :
+    _table{ size, maxLoadFactor, minLoadFactor }, _size{ _table.size() }, _length{ 0 }
+{
+    LOG_INF() << "Flat HashMap created! Size: " << _size << endl;
+}
+
+template < typename K, typename V, typename F, typename G >
+TSFlatHashMap<K, V, F, G>::~TSFlatHashMap()
+{
+    LOG_INF() << "Deleting Flat HashMap (" << length() << ")..." << endl;
+}
+
+template < typename K, typename V, typename F, typename G >
+bool TSFlatHashMap<K, V, F, G>::add( const K& key, const V& value )
+{
+    _mutex.writeLock();
+
+    const bool isAdded = _table.add( key, value );
+    updateCounters();
+
+    _mutex.rwUnlock();
+
+    return isAdded;
+}
+
+template < typename K, typename V, typename F, typename G >
+bool TSFlatHashMap<K, V, F, G>::del( const K& key )
+{
+    _mutex.writeLock();
+
+    const bool isDeleted = _table.del( key );
+    updateCounters();
+
+    _mutex.rwUnlock();
+
+    return isDeleted;
+}
+
+template < typename K, typename V, typename F, typename G >
+bool TSFlatHashMap<K, V, F, G>::find( const K& key, V& value )
+{
+    _mutex.readLock();
+
+    const V* found = _table.find( key );
+    if ( found ) value = *found;
+
+    _mutex.rwUnlock();
+
+    return ( found != nullptr );
+}
+
+template < typename K, typename V, typename F, typename G >
+const size_t TSFlatHashMap<K, V, F, G>::size( void ) const
+{
+    return _size;
+}
+
+template < typename K, typename V, typename F, typename G >
+const size_t TSFlatHashMap<K, V, F, G>::length( void ) const
+{
+    return _length;
+}
+
+template < typename K, typename V, typename F, typename G >
+const float TSFlatHashMap<K, V, F, G>::loadFactor( void ) const
+{
+    return ( (float) _length / _size );
+}
+
+template < typename K, typename V, typename F, typename G >
+const float TSFlatHashMap<K, V, F, G>::maxLoadFactor( void ) const
+{
+    return _table.maxLoadFactor();
+}
+
+template < typename K, typename V, typename F, typename G >
+const float TSFlatHashMap<K, V, F, G>::minLoadFactor( void ) const
+{
+    return _table.minLoadFactor();
+}
+
+template < typename K, typename V, typename F, typename G >
+bool TSFlatHashMap<K, V, F, G>::resize( const size_t size )
+{
+    _mutex.writeLock();
+
+    const bool isResized = _table.resize( size );
+    updateCounters();
+
+    _mutex.rwUnlock();
+
+    return isResized;
+}
+
+template < typename K, typename V, typename F, typename G >
+void TSFlatHashMap<K, V, F, G>::setLockPolicy( const ReadWriteLock::Policy policy )
+{
+    _mutex.setPolicy( policy );
+}
+
+template < typename K, typename V, typename F, typename G >
+ReadWriteLock::Stats TSFlatHashMap<K, V, F, G>::lockStats( void ) const
+{
+    return _mutex.stats();
+}
+
+template < typename K, typename V, typename F, typename G >
+void TSFlatHashMap<K, V, F, G>::resetLockStats( void )
+{
+    _mutex.resetStats();
+}
+
+template < typename K, typename V, typename F, typename G >
+void TSFlatHashMap<K, V, F, G>::print( void )
+{
+    _mutex.readLock();
+
+    /* Print length of hash map */
+    LOG_INF() << "HashMap Length: " << length() << endl;
+
+    /* Traverse slots and print key-value pairs */
+    _table.forEach( []( const K& key, const V& value )
+    {
+        LOG_INF() << "  { " << key << ", " << value << " }" << endl;
+    } );
+
+    _mutex.rwUnlock();
+}
+
+template < typename K, typename V, typename F, typename G >
+void TSFlatHashMap<K, V, F, G>::updateCounters( void )
+{
+    /* Caller must hold the write lock; counters are read without lock */
+    _size   = _table.size();
+    _length = _table.length();
+}
+
+} // HashMapTest
+
+
+#endif /* FLAT_HASHMAP_HPP_ */
@@ -0,0 +1,192 @@
+#ifndef HASH_FUNCTION_HPP_
+#define HASH_FUNCTION_HPP_
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+
+namespace HashMapTest {
+
+typedef uint64_t HashType;
+
+/*
+ * Hash functions return the full 64-bit hash of a key, F( key ); maps
+ * reduce it to a bucket with reduceHash. Lock stripes depend on it to pick
+ * the same stripe for a key at any table size, and open addressing tables
+ * take their tags from the bits above the bucket index, so all bits of a
+ * hash should depend on all bits of the key.
+ */
+
+/* Bucket of a hash; size is always a power of two, so a mask replaces the modulo */
+inline size_t reduceHash( const HashType hash, const size_t size )
+{
+    return ( hash & ( size - 1 ) );
+}
+
+/* Key as is; only good for keys that are random already */
+template < typename K >
+class IdentityHashFunction
+{
+public:
+    HashType operator()( const K& key ) const
+    {
+        return ( (HashType) key );
+    }
+};
+
+/*
+ * Multiply by 2^64 / golden ratio and fold the high half into the low one.
+ * One multiply; spreads sequential and strided integers over all buckets.
+ */
+template < typename K >
+class FibonacciHashFunction
+{
+public:
+    HashType operator()( const K& key ) const
+    {
+        const HashType hash = (HashType) key * 0x9E3779B97F4A7C15ULL;
+        return ( hash ^ ( hash >> 32 ) );
+    }
+};
+
+/* Finalizer of SplitMix64; full avalanche for integers at three multiplies */
+template < typename K >
+class MixHashFunction
+{
+public:
+    HashType operator()( const K& key ) const
+    {
+        HashType hash = (HashType) key + 0x9E3779B97F4A7C15ULL;
+        hash = ( hash ^ ( hash >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+        hash = ( hash ^ ( hash >> 27 ) ) * 0x94D049BB133111EBULL;
+        return ( hash ^ ( hash >> 31 ) );
+    }
+};
+
+/* 64 x 64 bit multiply, folding the 128 bit product */
+inline uint64_t multiplyFold( const uint64_t a, const uint64_t b )
+{
+    const __uint128_t product = (__uint128_t) a * b;
+    return ( (uint64_t) product ^ (uint64_t) ( product >> 64 ) );
+}
+
+inline uint64_t readBytes64( const uint8_t* bytes )
+{
+    uint64_t value;
+    memcpy( &value, bytes, sizeof( value ) );
+    return value;
+}
+
+inline uint64_t readBytes32( const uint8_t* bytes )
+{
+    uint32_t value;
+    memcpy( &value, bytes, sizeof( value ) );
+    return value;
+}
+
+/*
+ * Hash of a byte string in the style of wyhash: 16 or 48 bytes per round,
+ * each folded in with one wide multiply. Short strings are read with a few
+ * overlapping loads instead of a loop.
+ */
+inline HashType hashBytes( const void* data, const size_t length, uint64_t seed = 0 )
+{
+    const uint64_t secret[] = { 0xA0761D6478BD642FULL, 0xE7037ED1A0B428DBULL,
+                                0x8EBC6AF09C88C6E3ULL, 0x589965CC75374CC3ULL };
+
+    const uint8_t* bytes = (const uint8_t*) data;
+    uint64_t       a     = 0;
+    uint64_t       b     = 0;
+
+    seed ^= multiplyFold( seed ^ secret[ 0 ], secret[ 1 ] );
+
+    if ( length <= 16 )
+    {
+        if ( length >= 4 )
+        {
+            const size_t middle = ( length >> 3 ) << 2;
+            a = ( readBytes32( bytes ) << 32 ) | readBytes32( bytes + middle );
+            b = ( readBytes32( bytes + length - 4 ) << 32 ) | readBytes32( bytes + length - 4 - middle );
+        }
+        else if ( length > 0 )
+        {
+            a = ( (uint64_t) bytes[ 0 ] << 16 ) | ( (uint64_t) bytes[ length >> 1 ] << 8 ) | bytes[ length - 1 ];
+        }
+    }
+    else
+    {
+        size_t remaining = length;
+
+        /* Three independent lanes for long strings */
+        if ( remaining > 48 )
+        {
+            uint64_t seed1 = seed;
+            uint64_t seed2 = seed;
+
+            do
+            {
+                seed  = multiplyFold( readBytes64( bytes )      ^ secret[ 1 ], readBytes64( bytes + 8 )  ^ seed  );
+                seed1 = multiplyFold( readBytes64( bytes + 16 ) ^ secret[ 2 ], readBytes64( bytes + 24 ) ^ seed1 );
+                seed2 = multiplyFold( readBytes64( bytes + 32 ) ^ secret[ 3 ], readBytes64( bytes + 40 ) ^ seed2 );
+                bytes     += 48;
+                remaining -= 48;
+            }
+            while ( remaining > 48 );
+
+            seed ^= seed1 ^ seed2;
+        }
+
+        while ( remaining > 16 )
+        {
+            seed = multiplyFold( readBytes64( bytes ) ^ secret[ 1 ], readBytes64( bytes + 8 ) ^ seed );
+            bytes     += 16;
+            remaining -= 16;
+        }
+
+        /* Last 16 bytes; may overlap the previous round */
+        a = readBytes64( bytes + remaining - 16 );
+        b = readBytes64( bytes + remaining - 8 );
+    }
+
+    const __uint128_t product = (__uint128_t) ( a ^ secret[ 1 ] ) * ( b ^ seed );
+
+    return multiplyFold( (uint64_t) product ^ secret[ 0 ] ^ length, (uint64_t) ( product >> 64 ) ^ secret[ 1 ] );
+}
+
+/*
+ * Hash of strings. Transparent, so maps of std::string can be searched
+ * with C strings without building a temporary std::string.
+ */
+class StringHashFunction
+{
+public:
+    typedef void is_transparent;
+
+    HashType operator()( const std::string& key ) const
+    {
+        return hashBytes( key.data(), key.size() );
+    }
+
+    HashType operator()( const char* key ) const
+    {
+        return hashBytes( key, strlen( key ) );
+    }
+};
+
+/* Default hash functions; Fibonacci hashing for integers, hashBytes for strings */
+template < typename K >
+class DefaultHashFunction : public FibonacciHashFunction< K >
+{
+};
+
+template <>
+class DefaultHashFunction< std::string > : public StringHashFunction
+{
+};
+
+} // HashMapTest
+
+
+#endif /* HASH_FUNCTION_HPP_ */
@@ -1,84 +1,402 @@
 #ifndef HASHMAP_HPP_
 #define HASHMAP_HPP_
 
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
 #include "logger.hpp"
+#include "entry_pool.hpp"
+#include "hash_function.hpp"
+#include "epoch_reclaimer.hpp"
+#include "numa_topology.hpp"
 #include "read_write_lock.hpp"
+#include "op_stats.hpp"
 
 
 namespace HashMapTest {
 
-const unsigned int DEFAULT_HASHMAP_SIZE = 10;
-
-typedef unsigned int HashType;
+const unsigned int DEFAULT_HASHMAP_SIZE    = 16;
+const unsigned int DEFAULT_LOCK_STRIPES    = 1;
+const unsigned int CACHE_LINE_SIZE         = 64;
+const unsigned int MIGRATION_STEP          = 2;
+const float        DEFAULT_MAX_LOAD_FACTOR = 0.75f;
+const float        DEFAULT_MIN_LOAD_FACTOR = 0.125f;
+const unsigned int OPTIMISTIC_READ_RETRIES = 4;     // optimistic finds before taking the lock
+const unsigned int OPTIMISTIC_READ_STEPS   = 64;    // chain entries between sequence checks
+const unsigned int PREFETCH_GROUP          = 8;     // batched finds in flight at once
+
+/* Round up to the next power of two; sizes are always powers of two */
+inline size_t roundUpToPowerOfTwo( const size_t n )
+{
+    size_t power = 1;
+    while ( power < n ) power <<= 1;
+    return power;
+}
 
-template < typename K >
-class DefaultHashFunction
+/*
+ * Types that optimistic readers can copy while a writer updates them: small
+ * trivially copyable types that fit a naturally aligned atomic load.
+ */
+template < typename T >
+struct IsOptimisticReadable : std::integral_constant< bool,
+    std::is_trivially_copyable< T >::value && std::is_default_constructible< T >::value &&
+    sizeof( T ) <= sizeof( uint64_t ) && alignof( T ) == sizeof( T ) >
 {
-public:
-    HashType operator()( const K& key, const size_t size ) const
-    {
-        return ( (HashType) key % size );
-    }
 };
 
+/* Relaxed atomic copy of optimistic readable types; plain copy otherwise */
+template < typename T >
+inline T loadRelaxed( const T& from, std::true_type )
+{
+    T to;
+    __atomic_load( &from, &to, __ATOMIC_RELAXED );
+    return to;
+}
+
+template < typename T >
+inline T loadRelaxed( const T& from, std::false_type )
+{
+    return from;
+}
+
+template < typename T >
+inline void storeRelaxed( T& to, const T& from, std::true_type )
+{
+    __atomic_store( &to, &from, __ATOMIC_RELAXED );
+}
+
+template < typename T >
+inline void storeRelaxed( T& to, const T& from, std::false_type )
+{
+    to = from;
+}
+
+template < typename T >
+inline void storeRelaxed( T& to, T&& from, std::false_type )
+{
+    to = std::move( from );
+}
+
+/*
+ * Map entry. Links are atomic and values are updated with relaxed atomic
+ * stores (where the type allows), so optimistic readers may walk chains
+ * and copy values while a writer changes them. The value is constructed
+ * in place from any arguments, and rvalues are moved in, not copied.
+ * The full hash of the key is kept, so chain walks compare hashes before
+ * keys and resizes never hash a key again.
+ */
 template < typename K, typename V >
 class Entry
 {
 public:
-    Entry( const K& key, const V& value ) : _key{ key }, _value{ value }, _next{ nullptr }
+    template < typename... Args >
+    Entry( const HashType hash, const K& key, Args&&... args ) :
+        _hash{ hash }, _key{ key }, _value( std::forward< Args >( args )... ), _next{ nullptr }
     {
     }
 
     void setKey  ( const K& key )       { _key   = key;   }
-    void setValue( const V& value )     { _value = value; }
-    void setNext ( Entry*   next )      { _next  = next;  }
+    void setValue( const V& value )     { storeRelaxed( _value, value, IsOptimisticReadable< V >() ); }
+    void setValue( V&&      value )     { storeRelaxed( _value, std::move( value ), IsOptimisticReadable< V >() ); }
+    void setNext ( Entry*   next )      { _next.store( next, std::memory_order_release ); }
 
-    const K getKey  ( void ) const      { return _key;    }
-    const V getValue( void ) const      { return _value;  }
-    Entry*  getNext ( void ) const      { return _next;   }
+    HashType getHash  ( void ) const    { return _hash;   }
+    const K& getKey   ( void ) const    { return _key;    }
+    const V& getValue ( void ) const    { return _value;  }
+    const V  loadValue( void ) const    { return loadRelaxed( _value, IsOptimisticReadable< V >() ); }
+    Entry*   getNext  ( void ) const    { return _next.load( std::memory_order_acquire ); }
 
     void print( void ) const
     {
-        LOCK_STREAM();
         LOG_INF() << "  { " << _key << ", " << _value << " }" << endl;
-        UNLOCK_STREAM();
     }
 
 private:
-    K       _key;
-    V       _value;
-    Entry*  _next;
+    HashType                _hash;      // full hash of key
+    K                       _key;
+    V                       _value;
+    std::atomic< Entry* >   _next;
+};
+
+/* Lock stripe; padded so that neighbouring stripes don't share a cache line */
+template < typename L >
+struct LockStripe
+{
+    L                       lock;
+    std::atomic< size_t >   migrateIndex;   // next old bucket of this stripe to migrate
+    std::atomic< size_t >   sequence;       // odd while a writer changes the stripe
+    std::atomic< size_t >   length;         // entries in buckets of the stripe
+    std::atomic< size_t >   occupied;       // non-empty buckets of the stripe
+    std::atomic< size_t >   maxChain;       // longest chain added to since last resize
+    char                    padding[ CACHE_LINE_SIZE ];
 };
 
-template < typename K, typename V, typename F = DefaultHashFunction< K > >
+/* Change a counter of a stripe; only the holder of its write lock does, so no RMW is needed */
+inline void addRelaxed( std::atomic< size_t >& counter, const ptrdiff_t delta )
+{
+    counter.store( counter.load( std::memory_order_relaxed ) + delta, std::memory_order_relaxed );
+}
+
+/*
+ * Buckets are guarded by lock stripes; bucket i belongs to stripe
+ * ( i % stripes ). Table size and stripes are powers of two, and size is
+ * never less than stripes, so a key maps to the same stripe across resizes. Writers to buckets
+ * of different stripes proceed in parallel; resize and print take all
+ * stripes. With a single stripe, the map behaves like a single lock map.
+ *
+ * Resizing is incremental: resize only allocates the new table, while the
+ * old one is kept until all of its buckets are migrated. Every add / del
+ * migrates a few old buckets of its own stripe by relinking their entries,
+ * and migrate() can be called to drive the rest (e.g. by a helper thread).
+ * A key lives in the old table until its old bucket is migrated, so find
+ * looks into exactly one chain and never waits for a full rehash.
+ *
+ * The table doubles when length exceeds size * maxLoadFactor, and halves
+ * (but never below its initial size) when length drops under
+ * size * minLoadFactor. A minLoadFactor of 0 disables shrinking.
+ *
+ * Stripes are locked with L, a ReadWriteLock by default; read-mostly maps
+ * can use ScalableReadWriteLock so that finds don't share a cache line.
+ * All stripes share one lock policy (writer preferring by default);
+ * lockStats sums the fairness counters of all stripes.
+ *
+ * addMany / findMany / delMany take arrays of keys (and values), sort them
+ * by stripe and bucket, and lock every stripe once per batch. addMany
+ * first reserves room for the whole batch, so the table grows at most once
+ * per batch, and stores the last value of keys given more than once. Entries
+ * unlinked by delMany are released after all locks are dropped. findMany
+ * resolves PREFETCH_GROUP keys at a time: it hashes them and prefetches
+ * their buckets, then prefetches their first entries, and only then walks
+ * the chains, so the cache misses of a group overlap.
+ *
+ * add moves rvalue values into the map, and emplace constructs a value in
+ * place from its arguments if the key is absent; existing values are left
+ * untouched. visit calls a visitor with a const reference to the value
+ * under the stripe's read lock, so large values are read without a copy;
+ * the visitor must not call back into the map.
+ *
+ * Keys are hashed once per operation; the hash is kept in the entry and
+ * reduced to stripes and buckets with masks. Callers that already know a
+ * key's hash (see hashOf) can pass it to add, del, find and visit. If F
+ * declares is_transparent, find also accepts any key type that F hashes
+ * and that compares equal to K, e.g. const char* for std::string keys.
+ *
+ * setNode places the table and (with the pool allocator) new entries on a
+ * NUMA node; tables of later resizes follow. Tables share pages with other
+ * allocations only at their ends.
+ *
+ * Entries are created and destroyed through allocator A; the default pool
+ * keeps per-thread caches of free entries and releases all of them at once
+ * when the map is destroyed.
+ *
+ * With optimistic reads enabled (only for optimistic readable K and V),
+ * find takes no lock: writers keep the sequence of their stripe odd while
+ * changing it, and find retries if the sequence moved while it was
+ * reading, falling back to the read lock after a few attempts. Tables are
+ * only swapped while all stripes are odd. Readers may still hold deleted
+ * entries and replaced tables, so these are retired to an epoch reclaimer
+ * and freed in batches once no reader can hold them; reclaimStats tells
+ * how many are still pending.
+ *
+ * length and stats take no lock. Every stripe counts its entries, its
+ * non-empty buckets and its longest chain (as seen by adds since the last
+ * resize); writers change them under the stripe's lock with relaxed
+ * stores, and readers add them up with relaxed loads. A sum is exact when
+ * no writer runs, and otherwise lies between the values before and after
+ * the concurrent changes; it's not a snapshot of the whole map. While a
+ * resize migrates, occupied counts non-empty buckets of both tables.
+ *
+ * Built with HASHMAP_INSTRUMENT, the map records latency histograms of
+ * its operations, lock waits, resizes and chain lengths per thread (see
+ * OpStats); opStats merges them, e.g. to write them as JSON.
+ *
+ * Writers only look at their own stripe's length to decide on a resize
+ * (length of the stripe * stripes); the exact sum is taken only when that
+ * estimate crosses a threshold. If the whole map crosses one, some stripe
+ * does too, so the check is never missed for long.
+ */
+template < typename K, typename V, typename F = DefaultHashFunction< K >, typename A = PoolAllocator< Entry< K, V > >,
+           typename L = ReadWriteLock >
 class TSHashMap
 {
 public:
-    TSHashMap( const size_t size );
+    struct Stats
+    {
+        size_t      length;     // entries
+        size_t      size;       // buckets of the current table
+        size_t      occupied;   // non-empty buckets
+        size_t      maxChain;   // longest chain added to since last resize
+    };
+
+    TSHashMap( const size_t size,
+               const size_t stripes         = DEFAULT_LOCK_STRIPES,
+               const float  maxLoadFactor   = DEFAULT_MAX_LOAD_FACTOR,
+               const float  minLoadFactor   = DEFAULT_MIN_LOAD_FACTOR,
+               const bool   optimisticReads = false );
 
     ~TSHashMap();
 
     bool add ( const K& key, const V& value );
+    bool add ( const K& key, V&& value );
     bool del ( const K& key );
     bool find( const K& key, V& value );
 
-    const size_t size  ( void ) const;
-    const size_t length( void ) const;
+    bool add ( const K& key, const V& value, const HashType hash );
+    bool add ( const K& key, V&& value, const HashType hash );
+    bool del ( const K& key, const HashType hash );
+    bool find( const K& key, V& value, const HashType hash );
+
+    template < typename Q, typename Fn = F, typename = typename Fn::is_transparent >
+    bool find( const Q& key, V& value );
+
+    template < typename Q, typename Fn = F, typename = typename Fn::is_transparent >
+    bool find( const Q& key, V& value, const HashType hash );
+
+    template < typename... Args >
+    bool emplace( const K& key, Args&&... args );
+
+    template < typename Visitor >
+    bool visit( const K& key, Visitor&& visitor );
 
-    bool resize( const size_t size );
+    template < typename Visitor >
+    bool visit( const K& key, Visitor&& visitor, const HashType hash );
+
+    HashType hashOf( const K& key ) const;
+
+    size_t addMany ( const K* keys, const V* values, const size_t count );
+    size_t findMany( const K* keys, V* values, bool* found, const size_t count );
+    size_t delMany ( const K* keys, const size_t count );
+
+    const size_t size   ( void ) const;
+    const size_t length ( void ) const;
+    const size_t stripes( void ) const;
+
+    const bool isOptimistic( void ) const;
+
+    const float loadFactor   ( void ) const;
+    const float maxLoadFactor( void ) const;
+    const float minLoadFactor( void ) const;
+
+    bool resize ( const size_t size );
+    bool reserve( const size_t length );
+    bool migrate( const size_t buckets );
+
+    void                 setLockPolicy ( const typename L::Policy policy );
+    typename L::Stats    lockStats     ( void ) const;
+    void                 resetLockStats( void );
+
+    EpochReclaimer::Stats reclaimStats( void ) const;
+
+    Stats stats( void ) const;
+
+    OpStats::Snapshot opStats     ( void ) const;
+    void              resetOpStats( void );
+
+    void setNode( const int node );
+    int  node   ( void ) const;
 
     void print( void );
 
 private:
-    Entry<K, V>**   _hashTable;
-    F               _hashFunction;
-    size_t          _size;
-    size_t          _length;
-    ReadWriteLock   _mutex;
+    typedef std::atomic< Entry< K, V >* > Bucket;
+
+    /* Key of a batch, ordered by stripe and bucket */
+    struct BatchSlot
+    {
+        size_t      stripe;
+        size_t      bucket;
+        HashType    hash;
+        size_t      index;      // position in caller's arrays
+    };
+
+    size_t stripeOf( const HashType hash ) const;
+
+    Bucket* bucketOf( const HashType hash, const size_t stripe ) const;
+
+    void batchOrder( const K* keys, const size_t count, std::vector< BatchSlot >& batch ) const;
+
+    template < typename Op >
+    bool update( const HashType hash, Op op );
+
+    template < typename VV >
+    bool addLocked( const size_t stripe, const HashType hash, const K& key, VV&& value, bool& isAdded );
+
+    template < typename... Args >
+    bool emplaceLocked( const size_t stripe, const HashType hash, const K& key, bool& isAdded, Args&&... args );
+
+    Entry< K, V >* locateLocked( const size_t stripe, const HashType hash, const K& key,
+                                 Bucket*& bucket, Entry< K, V >*& prevEntry, size_t& chain );
+    bool           linkLocked  ( const size_t stripe, Bucket* bucket, Entry< K, V >* prevEntry,
+                                 Entry< K, V >* newEntry, const size_t chain );
+    Entry< K, V >* unlinkLocked( const size_t stripe, const HashType hash, const K& key );
+
+    template < typename Q >
+    bool findInChain( Entry< K, V >* entry, const HashType hash, const Q& key, V& value ) const;
+
+    template < typename Q >
+    bool findHashed( const Q& key, V& value, const HashType hash );
+
+    template < typename Q >
+    bool findLocked( const Q& key, V& value, const HashType hash );
+
+    template < typename Q >
+    bool findOptimistic( const Q& key, V& value, const HashType hash, std::true_type );
+
+    template < typename Q >
+    bool findOptimistic( const Q& key, V& value, const HashType hash, std::false_type );
+
+    size_t targetSize( const size_t length ) const;
+
+    bool rehash       ( const size_t size );
+    void autoResize   ( void );
+    void autoResize   ( const size_t stripe );
+    bool migrateStripe( const size_t stripe, size_t buckets );
+    void finishResize ( void );
+
+    void releaseEntry( Entry< K, V >* entry );
+    void releaseTable( Bucket* table );
+
+    static void destroyEntry( void* map, void* entry );
+    static void deleteTable ( void* map, void* table );
+
+    void readLockStripe   ( const size_t stripe );
+    void writeLockStripe  ( const size_t stripe );
+    void writeUnlockStripe( const size_t stripe );
+
+    void lockAllStripes  ( const bool isWrite );
+    void unlockAllStripes( const bool isWrite );
+
+    std::atomic< Bucket* >  _hashTable;
+    std::atomic< Bucket* >  _oldHashTable;
+    F                       _hashFunction;
+    A                       _allocator;
+    EpochReclaimer          _reclaimer;     // destroyed before _allocator
+    std::atomic< size_t >   _size;
+    std::atomic< size_t >   _oldSize;
+    size_t                  _minSize;
+    LockStripe< L >*        _stripes;
+    size_t                  _nStripes;
+    std::atomic< size_t >   _nMigrating;
+    float                   _maxLoadFactor;
+    float                   _minLoadFactor;
+    bool                    _isOptimistic;
+    int                     _node;          // NUMA node of tables and entries
+    mutable OpStats         _opStats;       // empty unless HASHMAP_INSTRUMENT
 };
 
-template < typename K, typename V, typename F >
-TSHashMap<K, V, F>::TSHashMap( const size_t size ) : _hashTable{ nullptr }, _size{ size }, _length{ 0 }
+template < typename K, typename V, typename F, typename A, typename L >
+TSHashMap<K, V, F, A, L>::TSHashMap( const size_t size,
+                                     const size_t stripes,
+                                     const float  maxLoadFactor,
+                                     const float  minLoadFactor,
+                                     const bool   optimisticReads ) :
+    _hashTable{ nullptr }, _oldHashTable{ nullptr }, _size{ size }, _oldSize{ 0 }, _minSize{ 0 },
+    _stripes{ nullptr }, _nStripes{ stripes }, _nMigrating{ 0 },
+    _maxLoadFactor{ maxLoadFactor }, _minLoadFactor{ minLoadFactor },
+    _isOptimistic{ optimisticReads }, _node{ NUMA_NO_NODE }
 {
     /* Validate positive size; use default size otherwise */
     if ( size <= 0 )
@@ -86,321 +404,630 @@ TSHashMap<K, V, F>::TSHashMap( const size_t size ) : _hashTable{ nullptr }, _siz
         _size = DEFAULT_HASHMAP_SIZE;
     }
 
+    /* Validate positive number of stripes; use single stripe otherwise */
+    if ( stripes <= 0 )
+    {
+        _nStripes = DEFAULT_LOCK_STRIPES;
+    }
+
+    /* Validate positive max load factor; use default otherwise */
+    if ( maxLoadFactor <= 0 )
+    {
+        _maxLoadFactor = DEFAULT_MAX_LOAD_FACTOR;
+    }
+
+    /* Keep shrink threshold well below growth threshold to avoid thrashing */
+    if ( minLoadFactor < 0 || minLoadFactor > _maxLoadFactor / 4 )
+    {
+        _minLoadFactor = _maxLoadFactor / 4;
+    }
+
+    /* Validate optimistic reads; keys and values must be copyable while written */
+    if ( optimisticReads && !( IsOptimisticReadable< V >::value && IsOptimisticReadable< K >::value ) )
+    {
+        LOG_WRN() << "Key or value type can't be read optimistically! Using locked reads..." << endl;
+
+        _isOptimistic = false;
+    }
+
+    /* Round stripes and size up to powers of two; size must cover stripes */
+    _nStripes = roundUpToPowerOfTwo( _nStripes );
+    _size     = roundUpToPowerOfTwo( std::max< size_t >( _size, _nStripes ) );
+    _minSize  = _size;
+
+    /* Allocate lock stripes */
+    _stripes = new LockStripe< L >[ _nStripes ];
+
+    for ( size_t i = 0; i < _nStripes; ++i )
+    {
+        _stripes[ i ].migrateIndex = 0;
+        _stripes[ i ].sequence     = 0;
+        _stripes[ i ].length       = 0;
+        _stripes[ i ].occupied     = 0;
+        _stripes[ i ].maxChain     = 0;
+    }
+
     /* Allocate memory for hash table / buckets */
-    _hashTable = new Entry<K, V>*[ _size ]{};
+    _hashTable = new Bucket[ _size ]{};
     if ( _hashTable == nullptr )
     {
-        LOCK_STREAM();
         LOG_ERR() << "Could not allocate memory for HashMap! Exiting..." << endl;
-        UNLOCK_STREAM();
 
         std::exit( EXIT_FAILURE );
     }
 
     /* Initialize HashMap table */
-    for ( size_t i = 0; i < _size; ++i ) _hashTable[ i ] = nullptr;
+    for ( size_t i = 0; i < _size; ++i ) _hashTable[ i ].store( nullptr, std::memory_order_relaxed );
 
-    LOCK_STREAM();
-    LOG_INF() << "HashMap created! Size: " << size << endl;
-    UNLOCK_STREAM();
+    LOG_INF() << "HashMap created! Size: " << _size << ", Stripes: " << _nStripes
+              << ( _isOptimistic ? ", Optimistic reads" : "" ) << endl;
 }
 
-template < typename K, typename V, typename F >
-TSHashMap<K, V, F>::~TSHashMap()
+template < typename K, typename V, typename F, typename A, typename L >
+TSHashMap<K, V, F, A, L>::~TSHashMap()
 {
-    LOCK_STREAM();
     LOG_INF() << "Deleting HashMap (" << length() << ")..." << endl;
-    UNLOCK_STREAM();
 
-    _mutex.writeLock();
+    lockAllStripes( true );
 
-    /* Remove all the variable sized lists first */
-    for ( size_t i = 0; i < _size; ++i )
-    {
-        /* Get entry for current list */
-        Entry< K, V >* thisEntry = _hashTable[ i ];
+    /* Entries of a bulk releasing allocator go with it; only run destructors */
+    const bool isBulkRelease = A::BULK_RELEASE;
+    const bool isTrivial     = std::is_trivially_destructible< Entry< K, V > >::value;
+
+    Bucket*      tables[] = { _oldHashTable, _hashTable };
+    const size_t sizes [] = { _oldSize, _size };
 
-        /* Remove the current entry list */
-        while ( thisEntry )
+    /* Remove all the variable sized lists of both old and new tables */
+    for ( size_t t = 0; t < 2 && !( isBulkRelease && isTrivial ); ++t )
+    {
+        for ( size_t i = 0; tables[ t ] && i < sizes[ t ]; ++i )
         {
-            Entry< K, V >* tempEntry = thisEntry;
-            thisEntry = thisEntry->getNext();
-            delete tempEntry;
+            /* Get entry for current list */
+            Entry< K, V >* thisEntry = tables[ t ][ i ].load( std::memory_order_relaxed );
+
+            /* Remove the current entry list */
+            while ( thisEntry )
+            {
+                Entry< K, V >* tempEntry = thisEntry;
+                thisEntry = thisEntry->getNext();
 
-            _length--;
+                if ( isBulkRelease ) tempEntry->~Entry();
+                else                 _allocator.destroy( tempEntry );
+            }
         }
+    }
 
-        /* Reset table entry */
-        _hashTable[ i ] = nullptr;
+    for ( size_t i = 0; i < _nStripes; ++i )
+    {
+        _stripes[ i ].length   = 0;
+        _stripes[ i ].occupied = 0;
     }
 
-    /* Delete and reset hash table */
-    delete [] _hashTable;
-    _hashTable = nullptr;
+    /* Delete and reset hash tables; retired ones go with the reclaimer */
+    delete [] _oldHashTable.load();
+    delete [] _hashTable.load();
 
-    _mutex.rwUnlock();
+    _oldHashTable = nullptr;
+    _hashTable    = nullptr;
+
+    unlockAllStripes( true );
+
+    /* Delete lock stripes */
+    delete [] _stripes;
+    _stripes = nullptr;
 
-    LOCK_STREAM();
     LOG_INF() << "HashMap deleted successfully!" << endl;
-    UNLOCK_STREAM();
 }
 
-template < typename K, typename V, typename F >
-bool TSHashMap<K, V, F>::add ( const K& key, const V& value )
+template < typename K, typename V, typename F, typename A, typename L >
+bool TSHashMap<K, V, F, A, L>::add ( const K& key, const V& value )
 {
-    Entry< K, V >* newEntry = nullptr;
-    Entry< K, V >* tmpEntry = nullptr;
+    return add( key, value, _hashFunction( key ) );
+}
 
-    _mutex.writeLock();
+template < typename K, typename V, typename F, typename A, typename L >
+bool TSHashMap<K, V, F, A, L>::add ( const K& key, V&& value )
+{
+    return add( key, std::move( value ), _hashFunction( key ) );
+}
 
-    /* Calculate hash value for new entry */
-    const HashType hash = _hashFunction( key, _size );
+template < typename K, typename V, typename F, typename A, typename L >
+bool TSHashMap<K, V, F, A, L>::del ( const K& key )
+{
+    return del( key, _hashFunction( key ) );
+}
 
-    /* Get entry location from hash table using hash */
-    newEntry = _hashTable[ hash ];
+template < typename K, typename V, typename F, typename A, typename L >
+bool TSHashMap<K, V, F, A, L>::find ( const K& key, V& value )
+{
+    return findHashed( key, value, _hashFunction( key ) );
+}
 
-    /* Check if entry already exists */
-    while ( newEntry && newEntry->getKey() != key )
+template < typename K, typename V, typename F, typename A, typename L >
+bool TSHashMap<K, V, F, A, L>::add ( const K& key, const V& value, const HashType hash )
+{
+    return update( hash, [ & ]( const size_t stripe, bool& isAdded )
     {
-        tmpEntry = newEntry;
-        newEntry = newEntry->getNext();
-    }
+        return addLocked( stripe, hash, key, value, isAdded );
+    } );
+}
 
-    /* Add new entry */
-    if ( !newEntry )
+template < typename K, typename V, typename F, typename A, typename L >
+bool TSHashMap<K, V, F, A, L>::add ( const K& key, V&& value, const HashType hash )
+{
+    return update( hash, [ & ]( const size_t stripe, bool& isAdded )
     {
-        /* Create new entry if it doesn't exist */
-        newEntry = new Entry< K, V >( key, value );
-        if ( !newEntry )
-        {
-            LOCK_STREAM();
-            LOG_ERR() << "Could not allocate memory for new node!" << endl;
-            UNLOCK_STREAM();
+        return addLocked( stripe, hash, key, std::move( value ), isAdded );
+    } );
+}
 
-            _mutex.rwUnlock();
-            return false;
-        }
+template < typename K, typename V, typename F, typename A, typename L >
+bool TSHashMap<K, V, F, A, L>::del ( const K& key, const HashType hash )
+{
+    const uint64_t start  = _opStats.now();
+    const size_t   stripe = stripeOf( hash );
 
-        if ( !tmpEntry )
-        {
-            /* Add first entry */
-            _hashTable[ hash ] = newEntry;
-        }
-        else
-        {
-            /* Add another entry in the chain */
-            tmpEntry->setNext( newEntry );
-        }
-    }
-    else
+    writeLockStripe( stripe );
+
+    /* Migrate a few buckets of an ongoing resize */
+    const bool isResized = migrateStripe( stripe, MIGRATION_STEP );
+
+    Entry< K, V >* thisEntry = unlinkLocked( stripe, hash, key );
+
+    writeUnlockStripe( stripe );
+
+    if ( isResized ) finishResize();
+
+    /* If entry not found, return false */
+    if ( !thisEntry )
     {
-        /* Update value existing entry */
-        newEntry->setValue( value );
+        _opStats.recordSince( OpStats::DEL, start );
+        return false;
     }
 
-    /* Increment length of hash map */
-    _length++;
+    /* Delete entry; it's unreachable already */
+    releaseEntry( thisEntry );
+
+    /* Shrink table if length dropped below min load factor */
+    autoResize( stripe );
 
-    _mutex.rwUnlock();
+    _opStats.recordSince( OpStats::DEL, start );
 
     return true;
 }
 
-template < typename K, typename V, typename F >
-bool TSHashMap<K, V, F>::del ( const K& key )
+template < typename K, typename V, typename F, typename A, typename L >
+bool TSHashMap<K, V, F, A, L>::find ( const K& key, V& value, const HashType hash )
 {
-    Entry< K, V >* prevEntry = nullptr;
-    Entry< K, V >* thisEntry = nullptr;
+    return findHashed( key, value, hash );
+}
 
-    _mutex.writeLock();
+template < typename K, typename V, typename F, typename A, typename L >
+template < typename Q, typename Fn, typename >
+bool TSHashMap<K, V, F, A, L>::find ( const Q& key, V& value )
+{
+    return findHashed( key, value, _hashFunction( key ) );
+}
 
-    /* Calculate hash to find the entry */
-    const HashType hash = _hashFunction( key, _size );
+template < typename K, typename V, typename F, typename A, typename L >
+template < typename Q, typename Fn, typename >
+bool TSHashMap<K, V, F, A, L>::find ( const Q& key, V& value, const HashType hash )
+{
+    return findHashed( key, value, hash );
+}
 
-    /* Get entry from the table if it exists */
-    thisEntry = _hashTable[ hash ];
+template < typename K, typename V, typename F, typename A, typename L >
+template < typename... Args >
+bool TSHashMap<K, V, F, A, L>::emplace( const K& key, Args&&... args )
+{
+    const HashType hash = _hashFunction( key );
 
-    /* Iterate through hash table to find the entry */
-    while ( thisEntry && thisEntry->getKey() != key )
+    return update( hash, [ & ]( const size_t stripe, bool& isAdded )
     {
-        prevEntry = thisEntry;
-        thisEntry = thisEntry->getNext();
-    }
+        return emplaceLocked( stripe, hash, key, isAdded, std::forward< Args >( args )... );
+    } );
+}
 
-    /* If entry not found, return false */
-    if ( !thisEntry )
+template < typename K, typename V, typename F, typename A, typename L >
+template < typename Visitor >
+bool TSHashMap<K, V, F, A, L>::visit( const K& key, Visitor&& visitor )
+{
+    return visit( key, std::forward< Visitor >( visitor ), _hashFunction( key ) );
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+template < typename Visitor >
+bool TSHashMap<K, V, F, A, L>::visit( const K& key, Visitor&& visitor, const HashType hash )
+{
+    const size_t stripe = stripeOf( hash );
+    L&           lock   = _stripes[ stripe ].lock;
+
+    /* Visitors may read any value type; always under the read lock */
+    readLockStripe( stripe );
+
+    Entry< K, V >* tmpEntry = bucketOf( hash, stripe )->load( std::memory_order_relaxed );
+
+    while ( tmpEntry && ( tmpEntry->getHash() != hash || tmpEntry->getKey() != key ) )
     {
-        _mutex.rwUnlock();
-        return false;
+        tmpEntry = tmpEntry->getNext();
     }
 
-    /* If found, remove entry from hash table */
-    if ( !prevEntry )
+    if ( tmpEntry ) visitor( tmpEntry->getValue() );
+
+    lock.rwUnlock();
+
+    return ( tmpEntry != nullptr );
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+HashType TSHashMap<K, V, F, A, L>::hashOf( const K& key ) const
+{
+    return _hashFunction( key );
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+size_t TSHashMap<K, V, F, A, L>::addMany( const K* keys, const V* values, const size_t count )
+{
+    /* Grow once for the whole batch, before keys are bucketed by size */
+    reserve( length() + count );
+
+    std::vector< BatchSlot > batch;
+    batchOrder( keys, count, batch );
+
+    size_t nStored   = 0;
+    bool   isResized = false;
+
+    /* Lock each stripe once for all of its keys */
+    for ( size_t first = 0, last = 0; first < count; first = last )
     {
-        /* If it's first entry, adjust bucket */
-        _hashTable[ hash ] = thisEntry->getNext();
+        const size_t stripe = batch[ first ].stripe;
+
+        writeLockStripe( stripe );
+
+        isResized = migrateStripe( stripe, MIGRATION_STEP ) || isResized;
+
+        for ( last = first; last < count && batch[ last ].stripe == stripe; ++last )
+        {
+            const size_t index   = batch[ last ].index;
+            bool         isAdded = false;
+
+            if ( addLocked( stripe, batch[ last ].hash, keys[ index ], values[ index ], isAdded ) ) nStored++;
+        }
+
+        writeUnlockStripe( stripe );
     }
-    else
+
+    if ( isResized ) finishResize();
+
+    /* Grow table if max load factor is exceeded */
+    autoResize();
+
+    return nStored;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+size_t TSHashMap<K, V, F, A, L>::findMany( const K* keys, V* values, bool* found, const size_t count )
+{
+    std::vector< BatchSlot > batch;
+    batchOrder( keys, count, batch );
+
+    size_t nFound = 0;
+
+    /* Read lock each stripe once for all of its keys */
+    for ( size_t first = 0, last = 0; first < count; first = last )
     {
-        /* If it's in the chain, adjust chain */
-        prevEntry->setNext( thisEntry->getNext() );
-    }
+        const size_t stripe = batch[ first ].stripe;
+        L&           lock   = _stripes[ stripe ].lock;
+
+        readLockStripe( stripe );
 
-    /* Delete entry */
-    delete thisEntry;
+        for ( last = first; last < count && batch[ last ].stripe == stripe; ) ++last;
 
-    /* Decrement length of hash map */
-    _length--;
+        /* Pipeline groups of keys so their cache misses overlap */
+        for ( size_t group = first; group < last; group += PREFETCH_GROUP )
+        {
+            const size_t   nKeys = std::min< size_t >( PREFETCH_GROUP, last - group );
+            Bucket*        buckets[ PREFETCH_GROUP ];
+            Entry< K, V >* entries[ PREFETCH_GROUP ];
 
-    _mutex.rwUnlock();
+            /* Hash all keys, prefetch their buckets */
+            for ( size_t i = 0; i < nKeys; ++i )
+            {
+                buckets[ i ] = bucketOf( batch[ group + i ].hash, stripe );
+                __builtin_prefetch( buckets[ i ], 0, 1 );
+            }
 
-    return true;
+            /* Load first entries, prefetch them */
+            for ( size_t i = 0; i < nKeys; ++i )
+            {
+                entries[ i ] = buckets[ i ]->load( std::memory_order_relaxed );
+                if ( entries[ i ] ) __builtin_prefetch( entries[ i ], 0, 1 );
+            }
+
+            /* Walk the chains */
+            for ( size_t i = 0; i < nKeys; ++i )
+            {
+                const size_t index   = batch[ group + i ].index;
+                const bool   isFound = findInChain( entries[ i ], batch[ group + i ].hash, keys[ index ], values[ index ] );
+
+                if ( found ) found[ index ] = isFound;
+                if ( isFound ) nFound++;
+            }
+        }
+
+        lock.rwUnlock();
+    }
+
+    return nFound;
 }
 
-template < typename K, typename V, typename F >
-bool TSHashMap<K, V, F>::find ( const K& key, V& value )
+template < typename K, typename V, typename F, typename A, typename L >
+size_t TSHashMap<K, V, F, A, L>::delMany( const K* keys, const size_t count )
 {
-    _mutex.readLock();
+    std::vector< BatchSlot > batch;
+    batchOrder( keys, count, batch );
 
-    /* Calculate hash value for the key */
-    const HashType hash = _hashFunction( key, _size );
+    std::vector< Entry< K, V >* > deleted;
+    deleted.reserve( count );
 
-    /* Get bucket against key */
-    Entry< K, V >* tmpEntry = _hashTable[ hash ];
+    bool isResized = false;
 
-    bool isFound = false;
-
-    /* Find entry in the chain, return true if found */
-    while ( tmpEntry && !isFound )
+    /* Unlink all entries of a stripe under one lock hold */
+    for ( size_t first = 0, last = 0; first < count; first = last )
     {
-        if ( tmpEntry->getKey() == key )
+        const size_t stripe = batch[ first ].stripe;
+
+        writeLockStripe( stripe );
+
+        isResized = migrateStripe( stripe, MIGRATION_STEP ) || isResized;
+
+        for ( last = first; last < count && batch[ last ].stripe == stripe; ++last )
         {
-            value = tmpEntry->getValue();
-            isFound = true;
+            Entry< K, V >* thisEntry = unlinkLocked( stripe, batch[ last ].hash, keys[ batch[ last ].index ] );
+            if ( thisEntry ) deleted.push_back( thisEntry );
         }
 
-        tmpEntry = tmpEntry->getNext();
+        writeUnlockStripe( stripe );
     }
 
-    _mutex.rwUnlock();
+    if ( isResized ) finishResize();
 
-    /* If entry not found, return false */
-    return isFound;
+    /* Delete entries after all locks are released */
+    for ( auto thisEntry : deleted ) releaseEntry( thisEntry );
+
+    /* Shrink table if length dropped below min load factor */
+    if ( !deleted.empty() ) autoResize();
+
+    return deleted.size();
 }
 
-template < typename K, typename V, typename F >
-const size_t TSHashMap<K, V, F>::size( void ) const
+template < typename K, typename V, typename F, typename A, typename L >
+const size_t TSHashMap<K, V, F, A, L>::size( void ) const
 {
     return _size;
 }
 
-template < typename K, typename V, typename F >
-const size_t TSHashMap<K, V, F>::length( void ) const
+template < typename K, typename V, typename F, typename A, typename L >
+const size_t TSHashMap<K, V, F, A, L>::length( void ) const
 {
-    return _length;
+    size_t length = 0;
+
+    for ( size_t i = 0; i < _nStripes; ++i ) length += _stripes[ i ].length.load( std::memory_order_relaxed );
+
+    return length;
 }
 
-template < typename K, typename V, typename F >
-bool TSHashMap<K, V, F>::resize( const size_t size )
+template < typename K, typename V, typename F, typename A, typename L >
+const size_t TSHashMap<K, V, F, A, L>::stripes( void ) const
 {
-    _mutex.writeLock();
+    return _nStripes;
+}
 
-    /* Validate new size; should be greater than old size */
-    if ( size <= _size )
-    {
-        LOCK_STREAM();
-        LOG_ERR() << "Cannot resize! New size must be greater than old size!" << endl;
-        UNLOCK_STREAM();
+template < typename K, typename V, typename F, typename A, typename L >
+const bool TSHashMap<K, V, F, A, L>::isOptimistic( void ) const
+{
+    return _isOptimistic;
+}
 
-        _mutex.rwUnlock();
+template < typename K, typename V, typename F, typename A, typename L >
+const float TSHashMap<K, V, F, A, L>::loadFactor( void ) const
+{
+    return ( (float) length() / _size );
+}
 
-        return false;
-    }
+template < typename K, typename V, typename F, typename A, typename L >
+const float TSHashMap<K, V, F, A, L>::maxLoadFactor( void ) const
+{
+    return _maxLoadFactor;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+const float TSHashMap<K, V, F, A, L>::minLoadFactor( void ) const
+{
+    return _minLoadFactor;
+}
 
-    /* Get pointer to old table */
-    auto oldHashTable = _hashTable;
+template < typename K, typename V, typename F, typename A, typename L >
+bool TSHashMap<K, V, F, A, L>::resize( const size_t size )
+{
+    /* Round new size up to a power of two; size must cover stripes */
+    const size_t   newSize = roundUpToPowerOfTwo( std::max< size_t >( size, _nStripes ) );
+    const uint64_t start   = _opStats.now();
 
-    /* Resent HashMap original table */
-    _hashTable = nullptr;
+    lockAllStripes( true );
 
-    /* Allocate memory for new HashMap table */
-    _hashTable = new Entry<K, V>*[ size ]{};
-    if ( _hashTable == nullptr )
+    /* Get old size */
+    const size_t oldSize = _size;
+
+    /* Validate new size; should differ from old size */
+    if ( newSize == oldSize )
     {
-        LOCK_STREAM();
-        LOG_ERR() << "Could not allocate memory for resizing! Returning..." << endl;
-        UNLOCK_STREAM();
+        unlockAllStripes( true );
 
-        _mutex.rwUnlock();
+        LOG_ERR() << "Cannot resize! New size must differ from old size!" << endl;
 
         return false;
     }
 
-    /* Reset new HashMap table */
-    for ( size_t i = 0; i < size; ++i ) _hashTable[ i ] = nullptr;
-
-    /* Get old size */
-    const size_t oldSize = _size;
+    const bool isResizing = rehash( newSize );
 
-    /* Reset new size and length */
-    _size   = size;
-    _length = 0;
+    unlockAllStripes( true );
 
-    /* Copy entries from old to new HashMap table */
-    for ( size_t i = 0; i < oldSize; ++i )
+    if ( isResizing )
     {
-        /* Check if an entry exists on current index */
-        if ( oldHashTable[ i ] != nullptr )
-        {
-            Entry<K, V>* thisEntry = oldHashTable[ i ];
-            Entry<K, V>* tempEntry = nullptr;
-
-            /* Copy entry chain if exists */
-            while ( thisEntry != nullptr )
-            {
-                add( thisEntry->getKey(), thisEntry->getValue() );
+        _opStats.recordSince( OpStats::RESIZE, start );
 
-                tempEntry = thisEntry;
-                thisEntry = thisEntry->getNext();
-                delete tempEntry;
-            }
-        }
+        LOG_INF() << "Resizing from " << oldSize << " to " << newSize << endl;
     }
 
-    /* Delete old HashMap table */
-    delete [] oldHashTable;
-    oldHashTable = nullptr;
+    return isResizing;
+}
 
-    _mutex.rwUnlock();
+template < typename K, typename V, typename F, typename A, typename L >
+bool TSHashMap<K, V, F, A, L>::reserve( const size_t length )
+{
+    /* Smallest size that holds length entries under the max load factor */
+    const size_t newSize = roundUpToPowerOfTwo( (size_t) ( length / _maxLoadFactor ) + 1 );
 
-    LOCK_STREAM();
-    LOG_ERR() << "Resized from " << oldSize << " to " << _size << endl;
-    UNLOCK_STREAM();
+    /* Cheap check first; never shrinks */
+    if ( newSize <= _size ) return false;
 
-    return true;
-}
+    const uint64_t start = _opStats.now();
 
-template < typename K, typename V, typename F >
-void TSHashMap<K, V, F>::print( void )
-{
-    Entry< K, V >* thisEntry = nullptr;
+    lockAllStripes( true );
 
-    _mutex.readLock();
+    /* Check again; another thread may have grown the table in the meantime */
+    const size_t oldSize    = _size;
+    const bool   isResizing = ( newSize > oldSize && rehash( newSize ) );
 
-    /* Print length of hash map */
-    LOCK_STREAM();
-    LOG_INF() << "HashMap Length: " << length() << endl;
-    UNLOCK_STREAM();
+    unlockAllStripes( true );
 
-    /* Traverse hash table and print key-value pairs */
-    for ( size_t i = 0; i < size(); ++i )
+    if ( isResizing )
     {
-        LOCK_STREAM();
-        LOG_INF() << "Bucket No: " << ( i + 1 ) << endl;
-        UNLOCK_STREAM();
+        _opStats.recordSince( OpStats::RESIZE, start );
 
-        /* Get first entry of bucket */
-        thisEntry = _hashTable[ i ];
+        LOG_INF() << "Reserving; resizing from " << oldSize << " to " << newSize << endl;
+    }
+
+    return isResizing;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+bool TSHashMap<K, V, F, A, L>::migrate( const size_t buckets )
+{
+    bool isResized = false;
+
+    /* Migrate given number of buckets of each stripe */
+    for ( size_t i = 0; i < _nStripes && _nMigrating > 0; ++i )
+    {
+        writeLockStripe( i );
+        isResized = migrateStripe( i, buckets ) || isResized;
+        writeUnlockStripe( i );
+    }
+
+    if ( isResized ) finishResize();
+
+    /* Return true if resize is still in progress */
+    return ( _nMigrating > 0 );
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+void TSHashMap<K, V, F, A, L>::setLockPolicy( const typename L::Policy policy )
+{
+    for ( size_t i = 0; i < _nStripes; ++i ) _stripes[ i ].lock.setPolicy( policy );
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+typename L::Stats TSHashMap<K, V, F, A, L>::lockStats( void ) const
+{
+    typename L::Stats stats{};
+
+    for ( size_t i = 0; i < _nStripes; ++i ) stats += _stripes[ i ].lock.stats();
+
+    return stats;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+void TSHashMap<K, V, F, A, L>::resetLockStats( void )
+{
+    for ( size_t i = 0; i < _nStripes; ++i ) _stripes[ i ].lock.resetStats();
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+EpochReclaimer::Stats TSHashMap<K, V, F, A, L>::reclaimStats( void ) const
+{
+    return _reclaimer.stats();
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+typename TSHashMap<K, V, F, A, L>::Stats TSHashMap<K, V, F, A, L>::stats( void ) const
+{
+    Stats stats{ 0, _size, 0, 0 };
+
+    for ( size_t i = 0; i < _nStripes; ++i )
+    {
+        stats.length   += _stripes[ i ].length.load( std::memory_order_relaxed );
+        stats.occupied += _stripes[ i ].occupied.load( std::memory_order_relaxed );
+        stats.maxChain  = std::max( stats.maxChain, _stripes[ i ].maxChain.load( std::memory_order_relaxed ) );
+    }
+
+    return stats;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+OpStats::Snapshot TSHashMap<K, V, F, A, L>::opStats( void ) const
+{
+    return _opStats.snapshot();
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+void TSHashMap<K, V, F, A, L>::resetOpStats( void )
+{
+    _opStats.reset();
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+void TSHashMap<K, V, F, A, L>::setNode( const int node )
+{
+    lockAllStripes( true );
+
+    _node = node;
+    _allocator.setNode( node );
+
+    /* Move current tables; later ones are bound when allocated */
+    if ( _node != NUMA_NO_NODE )
+    {
+        NumaTopology::bindMemory( _hashTable.load(), _size * sizeof( Bucket ), _node );
+
+        if ( _oldHashTable ) NumaTopology::bindMemory( _oldHashTable.load(), _oldSize * sizeof( Bucket ), _node );
+    }
+
+    unlockAllStripes( true );
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+int TSHashMap<K, V, F, A, L>::node( void ) const
+{
+    return _node;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+void TSHashMap<K, V, F, A, L>::print( void )
+{
+    Entry< K, V >* thisEntry = nullptr;
+
+    lockAllStripes( false );
+
+    /* Print length of hash map */
+    LOG_INF() << "HashMap Length: " << length() << endl;
+
+    /* Traverse hash table and print key-value pairs */
+    for ( size_t i = 0; i < size(); ++i )
+    {
+        LOG_INF() << "Bucket No: " << ( i + 1 ) << endl;
+
+        /* Get first entry of bucket */
+        thisEntry = _hashTable.load()[ i ].load( std::memory_order_relaxed );
 
         /* Traverse entire bucket and print entries */
         while( thisEntry )
@@ -410,7 +1037,632 @@ void TSHashMap<K, V, F>::print( void )
         }
     }
 
-    _mutex.rwUnlock();
+    /* Traverse old hash table buckets that are not migrated yet */
+    Bucket* oldHashTable = _oldHashTable;
+
+    for ( size_t i = 0; oldHashTable && i < _oldSize; ++i )
+    {
+        if ( !oldHashTable[ i ].load( std::memory_order_relaxed ) ) continue;
+
+        LOG_INF() << "Old Bucket No: " << ( i + 1 ) << endl;
+
+        for ( thisEntry = oldHashTable[ i ]; thisEntry; thisEntry = thisEntry->getNext() )
+        {
+            thisEntry->print();
+        }
+    }
+
+    unlockAllStripes( false );
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+size_t TSHashMap<K, V, F, A, L>::stripeOf( const HashType hash ) const
+{
+    return reduceHash( hash, _nStripes );
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+typename TSHashMap<K, V, F, A, L>::Bucket* TSHashMap<K, V, F, A, L>::bucketOf( const HashType hash, const size_t stripe ) const
+{
+    /* Key stays in old table until its old bucket is migrated */
+    Bucket* oldHashTable = _oldHashTable.load( std::memory_order_relaxed );
+    if ( oldHashTable )
+    {
+        const size_t oldBucket = reduceHash( hash, _oldSize.load( std::memory_order_relaxed ) );
+        if ( oldBucket >= _stripes[ stripe ].migrateIndex.load( std::memory_order_relaxed ) )
+        {
+            return &oldHashTable[ oldBucket ];
+        }
+    }
+
+    return &_hashTable.load( std::memory_order_relaxed )[ reduceHash( hash, _size.load( std::memory_order_relaxed ) ) ];
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+template < typename Q >
+bool TSHashMap<K, V, F, A, L>::findHashed( const Q& key, V& value, const HashType hash )
+{
+    const uint64_t start = _opStats.now();
+
+    const bool isFound = _isOptimistic
+        ? findOptimistic( key, value, hash, std::integral_constant< bool,
+              IsOptimisticReadable< K >::value && IsOptimisticReadable< V >::value >() )
+        : findLocked( key, value, hash );
+
+    _opStats.recordSince( OpStats::FIND, start );
+
+    return isFound;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+template < typename Q >
+bool TSHashMap<K, V, F, A, L>::findLocked( const Q& key, V& value, const HashType hash )
+{
+    const size_t stripe = stripeOf( hash );
+    L&           lock   = _stripes[ stripe ].lock;
+
+    readLockStripe( stripe );
+
+    const bool isFound = findInChain( bucketOf( hash, stripe )->load( std::memory_order_relaxed ), hash, key, value );
+
+    lock.rwUnlock();
+
+    return isFound;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+template < typename Q >
+bool TSHashMap<K, V, F, A, L>::findInChain( Entry< K, V >* entry, const HashType hash, const Q& key, V& value ) const
+{
+    /* Caller must hold the lock of the chain's stripe */
+    Entry< K, V >* tmpEntry = entry;
+
+    bool   isFound = false;
+    size_t steps   = 0;
+
+    /* Find entry in the chain, return true if found */
+    while ( tmpEntry && !isFound )
+    {
+        if ( tmpEntry->getHash() == hash && tmpEntry->getKey() == key )
+        {
+            value = tmpEntry->getValue();
+            isFound = true;
+        }
+
+        tmpEntry = tmpEntry->getNext();
+        steps++;
+    }
+
+    _opStats.record( OpStats::CHAIN, steps - isFound );
+
+    /* If entry not found, return false */
+    return isFound;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+template < typename Op >
+bool TSHashMap<K, V, F, A, L>::update( const HashType hash, Op op )
+{
+    bool isAdded = false;
+
+    const uint64_t start  = _opStats.now();
+    const size_t   stripe = stripeOf( hash );
+
+    writeLockStripe( stripe );
+
+    /* Migrate a few buckets of an ongoing resize */
+    const bool isResized = migrateStripe( stripe, MIGRATION_STEP );
+
+    const bool isStored = op( stripe, isAdded );
+
+    writeUnlockStripe( stripe );
+
+    if ( isResized ) finishResize();
+
+    /* Grow table if max load factor is exceeded */
+    if ( isAdded ) autoResize( stripe );
+
+    _opStats.recordSince( OpStats::ADD, start );
+
+    return isStored;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+template < typename VV >
+bool TSHashMap<K, V, F, A, L>::addLocked( const size_t stripe, const HashType hash, const K& key,
+                                          VV&& value, bool& isAdded )
+{
+    /* Caller must hold the write lock of stripe */
+    Bucket*        bucket   = nullptr;
+    Entry< K, V >* tmpEntry = nullptr;
+    size_t         chain    = 0;
+    Entry< K, V >* newEntry = locateLocked( stripe, hash, key, bucket, tmpEntry, chain );
+
+    isAdded = false;
+
+    /* Update value existing entry */
+    if ( newEntry )
+    {
+        newEntry->setValue( std::forward< VV >( value ) );
+        return true;
+    }
+
+    /* Create new entry if it doesn't exist */
+    isAdded = linkLocked( stripe, bucket, tmpEntry, _allocator.create( hash, key, std::forward< VV >( value ) ), chain );
+
+    return isAdded;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+template < typename... Args >
+bool TSHashMap<K, V, F, A, L>::emplaceLocked( const size_t stripe, const HashType hash, const K& key,
+                                              bool& isAdded, Args&&... args )
+{
+    /* Caller must hold the write lock of stripe */
+    Bucket*        bucket   = nullptr;
+    Entry< K, V >* tmpEntry = nullptr;
+    size_t         chain    = 0;
+
+    isAdded = false;
+
+    /* Leave existing entry as is */
+    if ( locateLocked( stripe, hash, key, bucket, tmpEntry, chain ) ) return false;
+
+    /* Construct value in place */
+    isAdded = linkLocked( stripe, bucket, tmpEntry, _allocator.create( hash, key, std::forward< Args >( args )... ),
+                          chain );
+
+    return isAdded;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+Entry< K, V >* TSHashMap<K, V, F, A, L>::locateLocked( const size_t stripe, const HashType hash, const K& key,
+                                                       Bucket*& bucket, Entry< K, V >*& prevEntry, size_t& chain )
+{
+    /* Caller must hold the write lock of stripe */
+    Entry< K, V >* thisEntry = nullptr;
+
+    prevEntry = nullptr;
+    chain     = 0;
+
+    /* Get bucket of the entry */
+    bucket = bucketOf( hash, stripe );
+
+    /* Get entry from the table if it exists */
+    thisEntry = bucket->load( std::memory_order_relaxed );
+
+    /* Iterate through the chain; prevEntry ends at the last entry if not found */
+    while ( thisEntry && ( thisEntry->getHash() != hash || thisEntry->getKey() != key ) )
+    {
+        prevEntry = thisEntry;
+        thisEntry = thisEntry->getNext();
+        chain++;
+    }
+
+    _opStats.record( OpStats::CHAIN, chain );
+
+    return thisEntry;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+bool TSHashMap<K, V, F, A, L>::linkLocked( const size_t stripe, Bucket* bucket, Entry< K, V >* prevEntry,
+                                           Entry< K, V >* newEntry, const size_t chain )
+{
+    /* Caller must hold the write lock of stripe; chain is the length of prevEntry's chain */
+    if ( !newEntry )
+    {
+        LOG_ERR() << "Could not allocate memory for new node!" << endl;
+
+        return false;
+    }
+
+    if ( !prevEntry )
+    {
+        /* Add first entry; publish it to optimistic readers */
+        bucket->store( newEntry, std::memory_order_release );
+    }
+    else
+    {
+        /* Add another entry in the chain */
+        prevEntry->setNext( newEntry );
+    }
+
+    /* Count entry, bucket and chain in the stripe */
+    LockStripe< L >& thisStripe = _stripes[ stripe ];
+
+    addRelaxed( thisStripe.length, 1 );
+    if ( !prevEntry ) addRelaxed( thisStripe.occupied, 1 );
+    if ( chain + 1 > thisStripe.maxChain.load( std::memory_order_relaxed ) )
+    {
+        thisStripe.maxChain.store( chain + 1, std::memory_order_relaxed );
+    }
+
+    return true;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+Entry< K, V >* TSHashMap<K, V, F, A, L>::unlinkLocked( const size_t stripe, const HashType hash, const K& key )
+{
+    /* Caller must hold the write lock of stripe */
+    Bucket*        bucket    = nullptr;
+    Entry< K, V >* prevEntry = nullptr;
+    size_t         chain     = 0;
+    Entry< K, V >* thisEntry = locateLocked( stripe, hash, key, bucket, prevEntry, chain );
+
+    /* If entry not found, return nullptr */
+    if ( !thisEntry ) return nullptr;
+
+    /* If found, remove entry from hash table */
+    if ( !prevEntry )
+    {
+        /* If it's first entry, adjust bucket */
+        bucket->store( thisEntry->getNext(), std::memory_order_release );
+    }
+    else
+    {
+        /* If it's in the chain, adjust chain */
+        prevEntry->setNext( thisEntry->getNext() );
+    }
+
+    /* Uncount entry, and bucket if it's empty now */
+    addRelaxed( _stripes[ stripe ].length, -1 );
+    if ( !prevEntry && !thisEntry->getNext() ) addRelaxed( _stripes[ stripe ].occupied, -1 );
+
+    return thisEntry;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+void TSHashMap<K, V, F, A, L>::batchOrder( const K* keys, const size_t count, std::vector< BatchSlot >& batch ) const
+{
+    /* Bucket by current size; it may change before the stripe is locked */
+    const size_t size = _size;
+
+    batch.resize( count );
+
+    for ( size_t i = 0; i < count; ++i )
+    {
+        batch[ i ].hash   = _hashFunction( keys[ i ] );
+        batch[ i ].stripe = stripeOf( batch[ i ].hash );
+        batch[ i ].bucket = reduceHash( batch[ i ].hash, size );
+        batch[ i ].index  = i;
+    }
+
+    std::sort( batch.begin(), batch.end(), []( const BatchSlot& a, const BatchSlot& b )
+    {
+        /* Ties keep batch order, so the last of duplicate keys is added last */
+        if ( a.stripe != b.stripe ) return ( a.stripe < b.stripe );
+        if ( a.bucket != b.bucket ) return ( a.bucket < b.bucket );
+
+        return ( a.index < b.index );
+    } );
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+template < typename Q >
+bool TSHashMap<K, V, F, A, L>::findOptimistic( const Q& key, V& value, const HashType hash, std::true_type )
+{
+    const size_t                 stripe   = stripeOf( hash );
+    const std::atomic< size_t >& sequence = _stripes[ stripe ].sequence;
+
+    /* Entries and tables seen here are not freed before the guard goes */
+    EpochReclaimer::Guard guard( _reclaimer );
+
+    for ( size_t attempt = 0; attempt < OPTIMISTIC_READ_RETRIES; ++attempt )
+    {
+        /* Odd sequence; a writer is changing the stripe */
+        const size_t before = sequence.load( std::memory_order_acquire );
+        if ( before & 1 )
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        /* Tables are swapped under all stripes; check the bucket before walking it */
+        Bucket* bucket = bucketOf( hash, stripe );
+
+        std::atomic_thread_fence( std::memory_order_acquire );
+        if ( sequence.load( std::memory_order_relaxed ) != before ) continue;
+
+        Entry< K, V >* tmpEntry = bucket->load( std::memory_order_acquire );
+
+        V      found   = V();
+        bool   isFound = false;
+        bool   isValid = true;
+        size_t steps   = 0;
+
+        /* Find entry in the chain; it may change under the reader */
+        while ( tmpEntry && !isFound && isValid )
+        {
+            if ( tmpEntry->getHash() == hash && tmpEntry->getKey() == key )
+            {
+                found   = tmpEntry->loadValue();
+                isFound = true;
+            }
+
+            tmpEntry = tmpEntry->getNext();
+
+            /* Don't follow links of a chain that changed for too long */
+            if ( ++steps % OPTIMISTIC_READ_STEPS == 0 )
+            {
+                std::atomic_thread_fence( std::memory_order_acquire );
+                isValid = ( sequence.load( std::memory_order_relaxed ) == before );
+            }
+        }
+
+        /* Result is valid only if no writer touched the stripe meanwhile */
+        std::atomic_thread_fence( std::memory_order_acquire );
+        if ( isValid && sequence.load( std::memory_order_relaxed ) == before )
+        {
+            _opStats.record( OpStats::CHAIN, steps - isFound );
+
+            if ( isFound ) value = found;
+            return isFound;
+        }
+    }
+
+    /* Too many writers; wait for them on the lock */
+    return findLocked( key, value, hash );
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+template < typename Q >
+bool TSHashMap<K, V, F, A, L>::findOptimistic( const Q& key, V& value, const HashType hash, std::false_type )
+{
+    return findLocked( key, value, hash );
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+size_t TSHashMap<K, V, F, A, L>::targetSize( const size_t length ) const
+{
+    const size_t size = _size;
+
+    /* Double the size when too loaded */
+    if ( length > size * _maxLoadFactor ) return ( size << 1 );
+
+    /* Halve the size when too sparse, but not below the initial size */
+    if ( size > _minSize && length < size * _minLoadFactor ) return ( size >> 1 );
+
+    return size;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+bool TSHashMap<K, V, F, A, L>::rehash( const size_t size )
+{
+    /* Caller must hold all stripes in write mode */
+
+    /* Allocate memory for new HashMap table */
+    auto newHashTable = new Bucket[ size ]{};
+    if ( newHashTable == nullptr )
+    {
+        LOG_ERR() << "Could not allocate memory for resizing! Returning..." << endl;
+
+        return false;
+    }
+
+    if ( _node != NUMA_NO_NODE ) NumaTopology::bindMemory( newHashTable, size * sizeof( Bucket ), _node );
+
+    /* Reset new HashMap table */
+    for ( size_t i = 0; i < size; ++i ) newHashTable[ i ].store( nullptr, std::memory_order_relaxed );
+
+    /* Complete previous resize, if any, before starting a new one */
+    for ( size_t i = 0; i < _nStripes; ++i ) migrateStripe( i, _oldSize );
+
+    if ( _oldHashTable ) releaseTable( _oldHashTable );
+
+    /* Keep current table as old table; entries are migrated lazily */
+    _oldHashTable = _hashTable.load();
+    _oldSize      = _size.load();
+    _hashTable    = newHashTable;
+    _size         = size;
+
+    /* Reset migration state and chain high-water marks of all stripes */
+    for ( size_t i = 0; i < _nStripes; ++i )
+    {
+        _stripes[ i ].migrateIndex = i;
+        _stripes[ i ].maxChain     = 0;
+    }
+
+    _nMigrating = _nStripes;
+
+    return true;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+void TSHashMap<K, V, F, A, L>::autoResize( void )
+{
+    /* Cheap check first; let an ongoing resize complete before next one */
+    if ( _nMigrating > 0 || targetSize( length() ) == _size ) return;
+
+    const uint64_t start = _opStats.now();
+
+    lockAllStripes( true );
+
+    /* Check again; another thread may have resized in the meantime */
+    const size_t oldSize = _size;
+    const size_t newSize = targetSize( length() );
+
+    const bool isResizing = ( _nMigrating == 0 && newSize != oldSize && rehash( newSize ) );
+
+    unlockAllStripes( true );
+
+    if ( isResizing )
+    {
+        _opStats.recordSince( OpStats::RESIZE, start );
+
+        LOG_INF() << "Resizing from " << oldSize << " to " << newSize
+                  << " (length: " << length() << ")" << endl;
+    }
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+void TSHashMap<K, V, F, A, L>::autoResize( const size_t stripe )
+{
+    /* Estimate length from the stripe; sum all stripes only if it crosses a threshold */
+    const size_t estimate = _stripes[ stripe ].length.load( std::memory_order_relaxed ) * _nStripes;
+
+    if ( _nMigrating > 0 || targetSize( estimate ) == _size ) return;
+
+    autoResize();
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+bool TSHashMap<K, V, F, A, L>::migrateStripe( const size_t stripe, size_t buckets )
+{
+    /* Caller must hold the write lock of stripe */
+    Bucket*      oldHashTable = _oldHashTable;
+    Bucket*      hashTable    = _hashTable;
+    const size_t oldSize      = _oldSize;
+    const size_t size         = _size;
+    size_t       index        = _stripes[ stripe ].migrateIndex;
+
+    if ( !oldHashTable || index >= oldSize ) return false;
+
+    std::atomic< size_t >& occupied = _stripes[ stripe ].occupied;
+
+    /* Relink entries of old buckets into the new table */
+    for ( ; buckets > 0 && index < oldSize; --buckets, index += _nStripes )
+    {
+        Entry<K, V>* thisEntry = oldHashTable[ index ].load( std::memory_order_relaxed );
+
+        if ( thisEntry ) addRelaxed( occupied, -1 );
+
+        while ( thisEntry != nullptr )
+        {
+            Entry<K, V>* nextEntry = thisEntry->getNext();
+
+            /* Push entry to the front of its new bucket */
+            const size_t bucket = reduceHash( thisEntry->getHash(), size );
+            Entry<K, V>* head   = hashTable[ bucket ].load( std::memory_order_relaxed );
+
+            if ( !head ) addRelaxed( occupied, 1 );
+
+            thisEntry->setNext( head );
+            hashTable[ bucket ].store( thisEntry, std::memory_order_release );
+
+            thisEntry = nextEntry;
+        }
+
+        oldHashTable[ index ].store( nullptr, std::memory_order_relaxed );
+    }
+
+    _stripes[ stripe ].migrateIndex = index;
+
+    /* Return true if this was the last stripe to be migrated */
+    return ( index >= oldSize && --_nMigrating == 0 );
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+void TSHashMap<K, V, F, A, L>::finishResize( void )
+{
+    /* Readers of other stripes may still look at the old table */
+    lockAllStripes( true );
+
+    if ( !_oldHashTable || _nMigrating > 0 )
+    {
+        unlockAllStripes( true );
+        return;
+    }
+
+    const size_t oldSize = _oldSize;
+
+    /* Delete old HashMap table */
+    releaseTable( _oldHashTable );
+    _oldHashTable = nullptr;
+    _oldSize      = 0;
+
+    const size_t newSize = _size;
+
+    unlockAllStripes( true );
+
+    LOG_INF() << "Resized from " << oldSize << " to " << newSize << endl;
+
+    /* Length may have moved past a threshold while migrating */
+    autoResize();
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+void TSHashMap<K, V, F, A, L>::releaseEntry( Entry< K, V >* entry )
+{
+    /* Optimistic readers may still hold the unlinked entry */
+    if ( _isOptimistic ) _reclaimer.retire( entry, &destroyEntry, this );
+    else                 _allocator.destroy( entry );
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+void TSHashMap<K, V, F, A, L>::releaseTable( Bucket* table )
+{
+    /* Optimistic readers may still hold the replaced table */
+    if ( _isOptimistic ) _reclaimer.retire( table, &deleteTable, this );
+    else                 delete [] table;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+void TSHashMap<K, V, F, A, L>::destroyEntry( void* map, void* entry )
+{
+    ( (TSHashMap*) map )->_allocator.destroy( (Entry< K, V >*) entry );
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+void TSHashMap<K, V, F, A, L>::deleteTable( void* map, void* table )
+{
+    ( void ) map;
+    delete [] (Bucket*) table;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+void TSHashMap<K, V, F, A, L>::readLockStripe( const size_t stripe )
+{
+    const uint64_t start = _opStats.now();
+
+    _stripes[ stripe ].lock.readLock();
+
+    _opStats.recordSince( OpStats::READ_WAIT, start );
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+void TSHashMap<K, V, F, A, L>::writeLockStripe( const size_t stripe )
+{
+    const uint64_t start = _opStats.now();
+
+    _stripes[ stripe ].lock.writeLock();
+
+    _opStats.recordSince( OpStats::WRITE_WAIT, start );
+
+    /* Make sequence odd before any change becomes visible */
+    std::atomic< size_t >& sequence = _stripes[ stripe ].sequence;
+    sequence.store( sequence.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+void TSHashMap<K, V, F, A, L>::writeUnlockStripe( const size_t stripe )
+{
+    /* Make sequence even after all changes are visible */
+    std::atomic< size_t >& sequence = _stripes[ stripe ].sequence;
+    sequence.store( sequence.load( std::memory_order_relaxed ) + 1, std::memory_order_release );
+
+    _stripes[ stripe ].lock.rwUnlock();
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+void TSHashMap<K, V, F, A, L>::lockAllStripes( const bool isWrite )
+{
+    /* Always lock in ascending order to avoid deadlocks */
+    for ( size_t i = 0; i < _nStripes; ++i )
+    {
+        if ( isWrite ) writeLockStripe( i );
+        else           readLockStripe( i );
+    }
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+void TSHashMap<K, V, F, A, L>::unlockAllStripes( const bool isWrite )
+{
+    for ( size_t i = _nStripes; i > 0; --i )
+    {
+        if ( isWrite ) writeUnlockStripe( i - 1 );
+        else           _stripes[ i - 1 ].lock.rwUnlock();
+    }
 }
 
 } // HashMapTest
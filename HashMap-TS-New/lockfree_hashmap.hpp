@@ -0,0 +1,630 @@
+#ifndef LOCKFREE_HASHMAP_HPP_
+#define LOCKFREE_HASHMAP_HPP_
+
+#include <new>
+#include <atomic>
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
+#include "logger.hpp"
+#include "hashmap.hpp"
+#include "epoch_reclaimer.hpp"
+
+
+namespace HashMapTest {
+
+const unsigned int LOCK_FREE_SEGMENTS = 64;     // segment s > 0 holds buckets [ 2^(s-1), 2^s )
+
+/* Reverse bits; split order keys sort by reversed hash */
+inline uint64_t reverseBits( uint64_t bits )
+{
+    bits = ( ( bits >> 1 ) & 0x5555555555555555ULL ) | ( ( bits & 0x5555555555555555ULL ) << 1 );
+    bits = ( ( bits >> 2 ) & 0x3333333333333333ULL ) | ( ( bits & 0x3333333333333333ULL ) << 2 );
+    bits = ( ( bits >> 4 ) & 0x0F0F0F0F0F0F0F0FULL ) | ( ( bits & 0x0F0F0F0F0F0F0F0FULL ) << 4 );
+    return __builtin_bswap64( bits );
+}
+
+/*
+ * Value that readers copy while writers replace it. Optimistic readable
+ * values are stored inline and replaced with a relaxed atomic store; other
+ * values are boxed, and the box is swapped and retired, so a reader always
+ * copies a complete old or new value.
+ */
+template < typename V, bool IS_INLINE = IsOptimisticReadable< V >::value >
+class AtomicValue;
+
+template < typename V >
+class AtomicValue< V, true >
+{
+public:
+    AtomicValue( const V& value ) : _value{ value }
+    {
+    }
+
+    bool isValid( void ) const  { return true; }
+
+    V load( void ) const
+    {
+        return loadRelaxed( _value, std::true_type() );
+    }
+
+    bool store( const V& value, EpochReclaimer& reclaimer )
+    {
+        ( void ) reclaimer;
+        storeRelaxed( _value, value, std::true_type() );
+        return true;
+    }
+
+private:
+    V   _value;
+};
+
+template < typename V >
+class AtomicValue< V, false >
+{
+public:
+    AtomicValue( const V& value ) : _value{ new ( std::nothrow ) V( value ) }
+    {
+    }
+
+    ~AtomicValue()
+    {
+        delete _value.load( std::memory_order_relaxed );
+    }
+
+    bool isValid( void ) const  { return _value.load( std::memory_order_relaxed ) != nullptr; }
+
+    V load( void ) const
+    {
+        return *_value.load( std::memory_order_acquire );
+    }
+
+    bool store( const V& value, EpochReclaimer& reclaimer )
+    {
+        V* newValue = new ( std::nothrow ) V( value );
+        if ( !newValue ) return false;
+
+        /* Readers may still copy the old value */
+        V* oldValue = _value.exchange( newValue, std::memory_order_acq_rel );
+        reclaimer.retire( oldValue, &deleteValue, nullptr );
+
+        return true;
+    }
+
+private:
+    static void deleteValue( void* context, void* value )
+    {
+        ( void ) context;
+        delete (V*) value;
+    }
+
+    std::atomic< V* >   _value;
+};
+
+/*
+ * Lock-free hash map on a split ordered list (Shalev & Shavit). All entries
+ * live in one sorted linked list, ordered by their bit reversed hash, and
+ * bucket i points to a sentinel node in front of the entries whose hash
+ * ends in i. Doubling the buckets only splits every bucket in two, so the
+ * map grows (or shrinks) by changing its size; nothing is ever moved, and
+ * new buckets insert their sentinel on first use.
+ *
+ * Nodes are inserted and unlinked with CAS (Harris / Michael), deleted
+ * nodes are marked in their next link first, and any thread that finds a
+ * marked node unlinks it. Every operation runs inside an epoch guard, and
+ * unlinked nodes and replaced values are freed through the reclaimer once
+ * no thread can hold them. No operation ever blocks.
+ *
+ * Buckets are allocated in segments that double in size, so the bucket
+ * array never has to be copied either. Sentinels stay in the list until
+ * the map is destroyed.
+ */
+template < typename K, typename V, typename F = DefaultHashFunction< K > >
+class LockFreeHashMap
+{
+public:
+    LockFreeHashMap( const size_t size,
+                     const float  maxLoadFactor = DEFAULT_MAX_LOAD_FACTOR,
+                     const float  minLoadFactor = DEFAULT_MIN_LOAD_FACTOR );
+
+    ~LockFreeHashMap();
+
+    LockFreeHashMap( const LockFreeHashMap& ) = delete;
+    LockFreeHashMap& operator=( const LockFreeHashMap& ) = delete;
+
+    bool add ( const K& key, const V& value );
+    bool del ( const K& key );
+    bool find( const K& key, V& value );
+
+    const size_t size  ( void ) const;
+    const size_t length( void ) const;
+
+    const float loadFactor   ( void ) const;
+    const float maxLoadFactor( void ) const;
+    const float minLoadFactor( void ) const;
+
+    bool resize( const size_t size );
+
+    EpochReclaimer::Stats reclaimStats( void ) const;
+
+    void print( void );
+
+private:
+    /* Sentinels have even order keys, entries odd ones */
+    struct NodeBase
+    {
+        NodeBase( const uint64_t order ) : order{ order }, next{ 0 }
+        {
+        }
+
+        const uint64_t              order;
+        std::atomic< uintptr_t >    next;   // lowest bit marks this node deleted
+    };
+
+    struct Node : NodeBase
+    {
+        Node( const uint64_t order, const K& key, const V& value ) : NodeBase{ order }, key{ key }, value{ value }
+        {
+        }
+
+        const K             key;
+        AtomicValue< V >    value;
+    };
+
+    typedef std::atomic< NodeBase* > Bucket;
+
+    static NodeBase* pointerOf( const uintptr_t link ) { return (NodeBase*) ( link & ~(uintptr_t) 1 ); }
+    static bool      isMarked ( const uintptr_t link ) { return ( link & 1 ); }
+    static bool      isEntry  ( const NodeBase* node ) { return ( node->order & 1 ); }
+
+    static uint64_t entryOrder   ( const HashType hash ) { return reverseBits( (uint64_t) hash | ( 1ULL << 63 ) ); }
+    static uint64_t sentinelOrder( const size_t bucket ) { return reverseBits( bucket ); }
+
+    static void deleteNode( void* context, void* node );
+
+    bool search( NodeBase* head, const uint64_t order, const K* key,
+                 std::atomic< uintptr_t >*& prev, NodeBase*& curr );
+
+    Bucket*   slotOf    ( const size_t bucket );
+    NodeBase* bucketOf  ( const HashType hash );
+    NodeBase* initBucket( const size_t bucket );
+
+    void autoResize( void );
+
+    std::atomic< Bucket* >  _segments[ LOCK_FREE_SEGMENTS ];
+    F                       _hashFunction;
+    EpochReclaimer          _reclaimer;
+    std::atomic< size_t >   _size;
+    size_t                  _minSize;
+    std::atomic< size_t >   _length;
+    float                   _maxLoadFactor;
+    float                   _minLoadFactor;
+};
+
+template < typename K, typename V, typename F >
+LockFreeHashMap<K, V, F>::LockFreeHashMap( const size_t size,
+                                           const float  maxLoadFactor,
+                                           const float  minLoadFactor ) :
+    _size{ size }, _minSize{ 0 }, _length{ 0 }, _maxLoadFactor{ maxLoadFactor }, _minLoadFactor{ minLoadFactor }
+{
+    /* Validate positive size; use default size otherwise */
+    if ( size <= 0 )
+    {
+        _size = DEFAULT_HASHMAP_SIZE;
+    }
+
+    /* Validate positive max load factor; use default otherwise */
+    if ( maxLoadFactor <= 0 )
+    {
+        _maxLoadFactor = DEFAULT_MAX_LOAD_FACTOR;
+    }
+
+    /* Keep shrink threshold well below growth threshold to avoid thrashing */
+    if ( minLoadFactor < 0 || minLoadFactor > _maxLoadFactor / 4 )
+    {
+        _minLoadFactor = _maxLoadFactor / 4;
+    }
+
+    _size    = roundUpToPowerOfTwo( _size );
+    _minSize = _size;
+
+    for ( auto& segment : _segments ) segment.store( nullptr, std::memory_order_relaxed );
+
+    /* Sentinel of bucket 0 is the head of the list */
+    Bucket* head = slotOf( 0 );
+    NodeBase* sentinel = head ? new ( std::nothrow ) NodeBase( sentinelOrder( 0 ) ) : nullptr;
+    if ( sentinel == nullptr )
+    {
+        LOG_ERR() << "Could not allocate memory for HashMap! Exiting..." << endl;
+
+        std::exit( EXIT_FAILURE );
+    }
+
+    head->store( sentinel, std::memory_order_release );
+
+    LOG_INF() << "Lock-free HashMap created! Size: " << _size << endl;
+}
+
+template < typename K, typename V, typename F >
+LockFreeHashMap<K, V, F>::~LockFreeHashMap()
+{
+    LOG_INF() << "Deleting HashMap (" << length() << ")..." << endl;
+
+    /* Remove all nodes still linked; unlinked ones go with the reclaimer */
+    NodeBase* thisNode = _segments[ 0 ].load()[ 0 ].load();
+
+    while ( thisNode )
+    {
+        NodeBase* nextNode = pointerOf( thisNode->next.load( std::memory_order_relaxed ) );
+
+        if ( isEntry( thisNode ) ) delete (Node*) thisNode;
+        else                       delete thisNode;
+
+        thisNode = nextNode;
+    }
+
+    _length = 0;
+
+    /* Delete bucket segments */
+    for ( auto& segment : _segments )
+    {
+        delete [] segment.load();
+        segment = nullptr;
+    }
+
+    LOG_INF() << "HashMap deleted successfully!" << endl;
+}
+
+template < typename K, typename V, typename F >
+bool LockFreeHashMap<K, V, F>::add( const K& key, const V& value )
+{
+    EpochReclaimer::Guard guard( _reclaimer );
+
+    const HashType hash  = _hashFunction( key );
+    const uint64_t order = entryOrder( hash );
+
+    NodeBase* head = bucketOf( hash );
+    Node*     node = nullptr;
+
+    std::atomic< uintptr_t >* prev = nullptr;
+    NodeBase*                 curr = nullptr;
+
+    while ( head )
+    {
+        /* Update value of existing entry */
+        if ( search( head, order, &key, prev, curr ) )
+        {
+            delete node;
+
+            if ( ( (Node*) curr )->value.store( value, _reclaimer ) ) return true;
+            break;
+        }
+
+        /* Create new entry once; it may take a few attempts to link */
+        if ( !node )
+        {
+            node = new ( std::nothrow ) Node( order, key, value );
+            if ( !node || !node->value.isValid() ) break;
+        }
+
+        /* Link new entry in front of curr */
+        node->next.store( (uintptr_t) curr, std::memory_order_relaxed );
+
+        uintptr_t expected = (uintptr_t) curr;
+        if ( prev->compare_exchange_strong( expected, (uintptr_t) node, std::memory_order_acq_rel ) )
+        {
+            /* Increment length of hash map */
+            _length++;
+
+            /* Grow table if max load factor is exceeded */
+            autoResize();
+
+            return true;
+        }
+    }
+
+    delete node;
+
+    LOG_ERR() << "Could not allocate memory for new node!" << endl;
+
+    return false;
+}
+
+template < typename K, typename V, typename F >
+bool LockFreeHashMap<K, V, F>::del( const K& key )
+{
+    EpochReclaimer::Guard guard( _reclaimer );
+
+    const HashType hash  = _hashFunction( key );
+    const uint64_t order = entryOrder( hash );
+
+    NodeBase* head = bucketOf( hash );
+    if ( !head ) return false;
+
+    std::atomic< uintptr_t >* prev = nullptr;
+    NodeBase*                 curr = nullptr;
+
+    while ( search( head, order, &key, prev, curr ) )
+    {
+        /* Mark entry deleted; only one thread can */
+        uintptr_t next = curr->next.load( std::memory_order_acquire );
+        if ( isMarked( next ) ) continue;
+
+        if ( !curr->next.compare_exchange_strong( next, next | 1, std::memory_order_acq_rel ) ) continue;
+
+        /* Decrement length of hash map */
+        _length--;
+
+        /* Unlink entry; let search do it if prev changed meanwhile */
+        uintptr_t expected = (uintptr_t) curr;
+        if ( prev->compare_exchange_strong( expected, next, std::memory_order_acq_rel ) )
+        {
+            _reclaimer.retire( curr, &deleteNode, nullptr );
+        }
+        else
+        {
+            search( head, order, &key, prev, curr );
+        }
+
+        /* Shrink table if length dropped below min load factor */
+        autoResize();
+
+        return true;
+    }
+
+    /* If entry not found, return false */
+    return false;
+}
+
+template < typename K, typename V, typename F >
+bool LockFreeHashMap<K, V, F>::find( const K& key, V& value )
+{
+    EpochReclaimer::Guard guard( _reclaimer );
+
+    const HashType hash = _hashFunction( key );
+
+    NodeBase* head = bucketOf( hash );
+    if ( !head ) return false;
+
+    std::atomic< uintptr_t >* prev = nullptr;
+    NodeBase*                 curr = nullptr;
+
+    if ( !search( head, entryOrder( hash ), &key, prev, curr ) ) return false;
+
+    value = ( (Node*) curr )->value.load();
+
+    return true;
+}
+
+template < typename K, typename V, typename F >
+const size_t LockFreeHashMap<K, V, F>::size( void ) const
+{
+    return _size;
+}
+
+template < typename K, typename V, typename F >
+const size_t LockFreeHashMap<K, V, F>::length( void ) const
+{
+    return _length;
+}
+
+template < typename K, typename V, typename F >
+const float LockFreeHashMap<K, V, F>::loadFactor( void ) const
+{
+    return ( (float) _length / _size );
+}
+
+template < typename K, typename V, typename F >
+const float LockFreeHashMap<K, V, F>::maxLoadFactor( void ) const
+{
+    return _maxLoadFactor;
+}
+
+template < typename K, typename V, typename F >
+const float LockFreeHashMap<K, V, F>::minLoadFactor( void ) const
+{
+    return _minLoadFactor;
+}
+
+template < typename K, typename V, typename F >
+bool LockFreeHashMap<K, V, F>::resize( const size_t size )
+{
+    /* Round new size up to a power of two */
+    const size_t newSize = roundUpToPowerOfTwo( std::max< size_t >( size, 1 ) );
+    const size_t oldSize = _size.exchange( newSize );
+
+    /* Validate new size; should differ from old size */
+    if ( newSize == oldSize )
+    {
+        LOG_ERR() << "Cannot resize! New size must differ from old size!" << endl;
+
+        return false;
+    }
+
+    LOG_INF() << "Resized from " << oldSize << " to " << newSize << endl;
+
+    return true;
+}
+
+template < typename K, typename V, typename F >
+EpochReclaimer::Stats LockFreeHashMap<K, V, F>::reclaimStats( void ) const
+{
+    return _reclaimer.stats();
+}
+
+template < typename K, typename V, typename F >
+void LockFreeHashMap<K, V, F>::print( void )
+{
+    EpochReclaimer::Guard guard( _reclaimer );
+
+    /* Print length of hash map */
+    LOG_INF() << "HashMap Length: " << length() << endl;
+
+    /* Traverse the list and print live entries; it may change meanwhile */
+    NodeBase* thisNode = _segments[ 0 ].load()[ 0 ].load( std::memory_order_acquire );
+
+    while ( thisNode )
+    {
+        const uintptr_t next = thisNode->next.load( std::memory_order_acquire );
+
+        if ( isEntry( thisNode ) && !isMarked( next ) )
+        {
+            LOG_INF() << "  { " << ( (Node*) thisNode )->key << ", " << ( (Node*) thisNode )->value.load() << " }" << endl;
+        }
+
+        thisNode = pointerOf( next );
+    }
+}
+
+template < typename K, typename V, typename F >
+void LockFreeHashMap<K, V, F>::deleteNode( void* context, void* node )
+{
+    ( void ) context;
+    delete (Node*) node;
+}
+
+template < typename K, typename V, typename F >
+bool LockFreeHashMap<K, V, F>::search( NodeBase* head, const uint64_t order, const K* key,
+                                       std::atomic< uintptr_t >*& prev, NodeBase*& curr )
+{
+    /* Caller must be in an epoch guard; sentinels are searched without key */
+retry:
+    prev = &head->next;
+    curr = pointerOf( prev->load( std::memory_order_acquire ) );
+
+    while ( curr )
+    {
+        const uintptr_t next = curr->next.load( std::memory_order_acquire );
+
+        /* Help unlink a deleted node; start over if prev changed */
+        if ( isMarked( next ) )
+        {
+            uintptr_t expected = (uintptr_t) curr;
+            if ( !prev->compare_exchange_strong( expected, next & ~(uintptr_t) 1, std::memory_order_acq_rel ) )
+            {
+                goto retry;
+            }
+
+            _reclaimer.retire( curr, &deleteNode, nullptr );
+
+            curr = pointerOf( next );
+            continue;
+        }
+
+        /* List is sorted by order key; entries of equal order are compared by key */
+        if ( curr->order > order ) return false;
+
+        if ( curr->order == order && ( !key || ( (Node*) curr )->key == *key ) ) return true;
+
+        prev = &curr->next;
+        curr = pointerOf( next );
+    }
+
+    return false;
+}
+
+template < typename K, typename V, typename F >
+typename LockFreeHashMap<K, V, F>::Bucket* LockFreeHashMap<K, V, F>::slotOf( const size_t bucket )
+{
+    /* Segment s > 0 holds 2^(s-1) buckets starting at 2^(s-1) */
+    const size_t segment = bucket ? ( 64 - __builtin_clzll( bucket ) ) : 0;
+    const size_t first   = segment ? ( (size_t) 1 << ( segment - 1 ) ) : 0;
+    const size_t length  = segment ? first : 1;
+
+    Bucket* buckets = _segments[ segment ].load( std::memory_order_acquire );
+
+    /* Allocate segment on first use; another thread may win */
+    if ( !buckets )
+    {
+        Bucket* newBuckets = new ( std::nothrow ) Bucket[ length ]{};
+        if ( !newBuckets ) return nullptr;
+
+        for ( size_t i = 0; i < length; ++i ) newBuckets[ i ].store( nullptr, std::memory_order_relaxed );
+
+        if ( _segments[ segment ].compare_exchange_strong( buckets, newBuckets, std::memory_order_acq_rel ) )
+        {
+            buckets = newBuckets;
+        }
+        else
+        {
+            delete [] newBuckets;
+        }
+    }
+
+    return &buckets[ bucket - first ];
+}
+
+template < typename K, typename V, typename F >
+typename LockFreeHashMap<K, V, F>::NodeBase* LockFreeHashMap<K, V, F>::bucketOf( const HashType hash )
+{
+    const size_t bucket = reduceHash( hash, _size.load( std::memory_order_relaxed ) );
+
+    Bucket* slot = slotOf( bucket );
+    if ( !slot ) return nullptr;
+
+    NodeBase* sentinel = slot->load( std::memory_order_acquire );
+
+    return sentinel ? sentinel : initBucket( bucket );
+}
+
+template < typename K, typename V, typename F >
+typename LockFreeHashMap<K, V, F>::NodeBase* LockFreeHashMap<K, V, F>::initBucket( const size_t bucket )
+{
+    /* Bucket splits from the bucket without its highest bit; make sure that one exists */
+    const size_t parent = bucket & ~( (size_t) 1 << ( 63 - __builtin_clzll( bucket ) ) );
+
+    Bucket* parentSlot = slotOf( parent );
+    if ( !parentSlot ) return nullptr;
+
+    NodeBase* head = parentSlot->load( std::memory_order_acquire );
+    if ( !head ) head = initBucket( parent );
+    if ( !head ) return nullptr;
+
+    NodeBase* sentinel = new ( std::nothrow ) NodeBase( sentinelOrder( bucket ) );
+    if ( !sentinel ) return nullptr;
+
+    std::atomic< uintptr_t >* prev = nullptr;
+    NodeBase*                 curr = nullptr;
+
+    /* Link sentinel into the parent's part of the list, unless another thread did */
+    while ( true )
+    {
+        if ( search( head, sentinel->order, nullptr, prev, curr ) )
+        {
+            delete sentinel;
+            sentinel = curr;
+            break;
+        }
+
+        sentinel->next.store( (uintptr_t) curr, std::memory_order_relaxed );
+
+        uintptr_t expected = (uintptr_t) curr;
+        if ( prev->compare_exchange_strong( expected, (uintptr_t) sentinel, std::memory_order_acq_rel ) ) break;
+    }
+
+    slotOf( bucket )->store( sentinel, std::memory_order_release );
+
+    return sentinel;
+}
+
+template < typename K, typename V, typename F >
+void LockFreeHashMap<K, V, F>::autoResize( void )
+{
+    size_t       size   = _size.load( std::memory_order_relaxed );
+    const size_t length = _length.load( std::memory_order_relaxed );
+
+    /* Double the size when too loaded; halve it when too sparse, but not below the initial size */
+    if ( length > size * _maxLoadFactor && size < ( (size_t) 1 << ( LOCK_FREE_SEGMENTS - 2 ) ) )
+    {
+        _size.compare_exchange_strong( size, size << 1 );
+    }
+    else if ( size > _minSize && length < size * _minLoadFactor )
+    {
+        _size.compare_exchange_strong( size, size >> 1 );
+    }
+}
+
+} // HashMapTest
+
+
+#endif /* LOCKFREE_HASHMAP_HPP_ */
@@ -0,0 +1,380 @@
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include "logger.hpp"
+
+
+using std::lock_guard;
+using std::memory_order_relaxed;
+using std::memory_order_acquire;
+using std::memory_order_release;
+
+/* Lines of one thread; the thread pushes at head, the drain thread pops at tail */
+struct Logger::Ring
+{
+    std::vector< string >   slots;
+    size_t                  mask;
+    std::atomic< size_t >   head;
+    std::atomic< size_t >   tail;
+    std::atomic< bool >     inUse;      // owned by a thread
+};
+
+struct Logger::State
+{
+    /* The text sink; its lock guards the stream only */
+    struct Sink
+    {
+        mutex       lock;
+        ostream*    stream;
+    };
+
+    Sink                                    sink;
+    mutex                                   ringMutex;  // guards rings and the async mode
+    std::vector< std::unique_ptr< Ring > >  rings;
+    std::thread                             drainer;
+    std::atomic< bool >                     isAsync;
+    std::atomic< bool >                     isRunning;  // drain thread keeps going
+    std::atomic< uint64_t >                 generation; // rings of older generations are gone
+    size_t                                  capacity;
+    Overflow                                overflow;
+    std::atomic< uint64_t >                 written;
+    std::atomic< uint64_t >                 dropped;
+    std::atomic< uint64_t >                 blocked;
+
+    State() : sink{ {}, &cout }, isAsync{ false }, isRunning{ false }, generation{ 0 },
+              capacity{ LOG_RING_CAPACITY }, overflow{ Overflow::DROP }, written{ 0 }, dropped{ 0 }, blocked{ 0 }
+    {
+    }
+
+    ~State()
+    {
+        stop();
+    }
+
+    void stop( void );
+
+    /* Writes text to the stream as one piece */
+    void write( const string& text, const size_t nLines )
+    {
+        lock_guard< mutex > lock( sink.lock );
+
+        *sink.stream << text;
+        sink.stream->flush();
+
+        written.fetch_add( nLines, memory_order_relaxed );
+    }
+};
+
+/* Ring of the calling thread, given back when the thread exits */
+struct Logger::ThreadRing
+{
+    Ring*       ring;
+    uint64_t    generation;
+
+    ~ThreadRing();
+};
+
+/* Constant initialized; usable before any constructor of any unit runs */
+std::atomic< unsigned int > Logger::_level{ 0 };
+
+Logger::State& Logger::state( void )
+{
+    static State thisState;
+    return thisState;
+}
+
+static const char* levelOf( const Logger::Level level )
+{
+    switch ( level )
+    {
+        case Logger::Level::INF: return "[INF]";
+        case Logger::Level::WRN: return "[WRN]";
+        case Logger::Level::ERR: return "[ERR]";
+    }
+
+    return "[???]";
+}
+
+template < typename T >
+static T take( const char* record, size_t& offset )
+{
+    T value;
+    memcpy( &value, record + offset, sizeof( value ) );
+    offset += sizeof( value );
+    return value;
+}
+
+void Logger::State::stop( void )
+{
+    if ( !isRunning ) return;
+
+    /* New lines go to the stream directly; drain thread writes the rest */
+    isAsync   = false;
+    isRunning = false;
+    drainer.join();
+
+    lock_guard< mutex > lock( ringMutex );
+    generation++;
+    rings.clear();
+}
+
+Logger::ThreadRing::~ThreadRing()
+{
+    if ( !ring ) return;
+
+    State& thisState = state();
+
+    /* Rings of an older generation are freed already */
+    lock_guard< mutex > lock( thisState.ringMutex );
+    if ( generation == thisState.generation ) ring->inUse = false;
+}
+
+void Logger::setLevel( const Level level )
+{
+    _level.store( (unsigned int) level, memory_order_relaxed );
+}
+
+void Logger::format( const char* record, const size_t size, string& text )
+{
+    Site site;
+    memcpy( &site, record, sizeof( site ) );
+
+    text += levelOf( site.level );
+    text += " : ";
+    text += site.file;
+    text += ": ";
+    text += site.func;
+    text += "(): ";
+    text += std::to_string( site.line );
+    text += ": ";
+
+    for ( size_t offset = sizeof( site ); offset < size; )
+    {
+        const Tag tag = (Tag) record[ offset++ ];
+
+        switch ( tag )
+        {
+            case SIGNED:
+                text += std::to_string( take< int64_t >( record, offset ) );
+                break;
+
+            case UNSIGNED:
+                text += std::to_string( take< uint64_t >( record, offset ) );
+                break;
+
+            case FLOATING:
+            {
+                /* As ostream does by default */
+                char number[ 32 ];
+                snprintf( number, sizeof( number ), "%g", take< double >( record, offset ) );
+                text += number;
+                break;
+            }
+
+            case CHARACTER:
+                text += take< char >( record, offset );
+                break;
+
+            case TEXT:
+            {
+                const uint32_t length = take< uint32_t >( record, offset );
+                text.append( record + offset, length );
+                offset += length;
+                break;
+            }
+
+            case NEWLINE:
+                text += '\n';
+                break;
+        }
+    }
+}
+
+void Logger::setStream( ostream& stream )
+{
+    State& thisState = state();
+
+    lock_guard< mutex > lock( thisState.sink.lock );
+    thisState.sink.stream = &stream;
+}
+
+bool Logger::startAsync( const size_t capacity, const Overflow overflow )
+{
+    State& thisState = state();
+
+    lock_guard< mutex > lock( thisState.ringMutex );
+
+    if ( thisState.isRunning ) return false;
+
+    /* Round capacity up to a power of two for masking */
+    thisState.capacity = 1;
+    while ( thisState.capacity < capacity ) thisState.capacity <<= 1;
+
+    thisState.overflow  = overflow;
+    thisState.isRunning = true;
+    thisState.generation++;
+    thisState.drainer   = std::thread( drain );
+    thisState.isAsync   = true;
+
+    return true;
+}
+
+void Logger::stopAsync( void )
+{
+    state().stop();
+}
+
+bool Logger::openBinary( const char* path, const size_t bytes )
+{
+    return BinaryLog::open( path, bytes );
+}
+
+bool Logger::closeBinary( void )
+{
+    return BinaryLog::close();
+}
+
+Logger::Stats Logger::stats( void )
+{
+    const State& thisState = state();
+
+    return Stats{ thisState.written.load( memory_order_relaxed ),
+                  thisState.dropped.load( memory_order_relaxed ),
+                  thisState.blocked.load( memory_order_relaxed ) };
+}
+
+void Logger::submit( const char* record, const size_t size )
+{
+    State& thisState = state();
+
+    if ( BinaryLog::isOpen() )
+    {
+        Site site;
+        memcpy( &site, record, sizeof( site ) );
+
+        BinaryLog::write( (unsigned int) site.level, site.file, site.func, site.line,
+                          record + sizeof( site ), size - sizeof( site ) );
+        return;
+    }
+
+    if ( !thisState.isAsync )
+    {
+        string text;
+
+        format( record, size, text );
+        thisState.write( text, 1 );
+
+        return;
+    }
+
+    Ring&        ring = threadRing();
+    const size_t head = ring.head.load( memory_order_relaxed );
+
+    /* Full ring; drop the line or wait for the drain thread */
+    if ( head - ring.tail.load( memory_order_acquire ) > ring.mask )
+    {
+        if ( thisState.overflow == Overflow::DROP )
+        {
+            thisState.dropped.fetch_add( 1, memory_order_relaxed );
+            return;
+        }
+
+        thisState.blocked.fetch_add( 1, memory_order_relaxed );
+
+        while ( head - ring.tail.load( memory_order_acquire ) > ring.mask ) std::this_thread::yield();
+    }
+
+    /* Copy; the slot keeps its capacity, so there's no allocation once warm */
+    ring.slots[ head & ring.mask ].assign( record, size );
+    ring.head.store( head + 1, memory_order_release );
+}
+
+Logger::Ring& Logger::threadRing( void )
+{
+    static thread_local ThreadRing thisRing{ nullptr, 0 };
+
+    State& thisState = state();
+
+    if ( thisRing.ring && thisRing.generation == thisState.generation ) return *thisRing.ring;
+
+    lock_guard< mutex > lock( thisState.ringMutex );
+
+    thisRing.ring       = nullptr;
+    thisRing.generation = thisState.generation;
+
+    /* Reuse a ring of an exited thread, along with its pending lines */
+    for ( auto& ring : thisState.rings )
+    {
+        bool isInUse = false;
+        if ( ring->inUse.compare_exchange_strong( isInUse, true ) )
+        {
+            thisRing.ring = ring.get();
+            return *thisRing.ring;
+        }
+    }
+
+    Ring* ring = new Ring();
+
+    ring->slots.resize( thisState.capacity );
+    ring->mask  = thisState.capacity - 1;
+    ring->head  = 0;
+    ring->tail  = 0;
+    ring->inUse = true;
+
+    thisState.rings.emplace_back( ring );
+    thisRing.ring = ring;
+
+    return *ring;
+}
+
+/* Format pending lines of all rings and write them in one batch; returns lines written */
+size_t Logger::drainRings( string& batch )
+{
+    State& thisState = state();
+    size_t nLines    = 0;
+
+    batch.clear();
+
+    {
+        lock_guard< mutex > lock( thisState.ringMutex );
+
+        for ( auto& ring : thisState.rings )
+        {
+            const size_t head = ring->head.load( memory_order_acquire );
+            size_t       tail = ring->tail.load( memory_order_relaxed );
+
+            for ( ; tail != head; ++tail, ++nLines )
+            {
+                const string& slot = ring->slots[ tail & ring->mask ];
+
+                format( slot.data(), slot.size(), batch );
+            }
+
+            ring->tail.store( tail, memory_order_release );
+        }
+    }
+
+    /* Rings are free again while the stream writes */
+    if ( nLines > 0 ) thisState.write( batch, nLines );
+
+    return nLines;
+}
+
+void Logger::drain( void )
+{
+    State& thisState = state();
+    string batch;
+
+    while ( thisState.isRunning )
+    {
+        if ( drainRings( batch ) == 0 )
+        {
+            std::this_thread::sleep_for( std::chrono::milliseconds( LOG_DRAIN_INTERVAL_MS ) );
+        }
+    }
+
+    /* Lines pushed before stop */
+    while ( drainRings( batch ) > 0 );
+}
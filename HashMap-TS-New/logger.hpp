@@ -2,6 +2,14 @@
 #define LOGGER_HPP_
 
 #include <mutex>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <iostream>
+#include "binary_log.hpp"
 
 using std::cout;
 using std::endl;
@@ -9,58 +17,232 @@ using std::string;
 using std::ostream;
 using std::mutex;
 
-/* Global stream lock */
-mutex globalStreamLock;
+/* Lowest level compiled in: 0 INF, 1 WRN, 2 ERR, 3 none; e.g. -DLOG_MIN_LEVEL=1 */
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
 
-/* Global stream lock macros */
-#define LOCK_STREAM()       globalStreamLock.lock()
-#define UNLOCK_STREAM()     globalStreamLock.unlock()
+/* Logging Macros; arguments of a disabled level are not evaluated */
+#define LOG_AT( level ) \
+        !Logger::isEnabled( level ) ? (void) 0 : \
+        Logger::Voidify() & Logger::log( level, __FILE__, __FUNCTION__, __LINE__ )
 
-/* Logging Macros */
-#define LOG_INF() \
-        Logger::log( Logger::Level::INF, __FILE__, __FUNCTION__, __LINE__ )
+#define LOG_INF()   LOG_AT( Logger::Level::INF )
+#define LOG_WRN()   LOG_AT( Logger::Level::WRN )
+#define LOG_ERR()   LOG_AT( Logger::Level::ERR )
 
-#define LOG_WRN() \
-        Logger::log( Logger::Level::WRN, __FILE__, __FUNCTION__, __LINE__ )
-
-#define LOG_ERR() \
-        Logger::log( Logger::Level::ERR, __FILE__, __FUNCTION__, __LINE__ )
+const size_t       LOG_RECORD_SIZE       = 1024;    // bytes of a line's record; longer lines are cut
+const size_t       LOG_RING_CAPACITY     = 1024;    // lines per thread ring; power of two
+const size_t       LOG_BINARY_SIZE       = 64 << 20; // bytes of a binary log file
+const unsigned int LOG_DRAIN_INTERVAL_MS = 1;       // drain thread's sleep when idle
 
 
 /** Logger Class - Definition **/
 
+/*
+ * LOG_XXX() returns a Line, a record of LOG_RECORD_SIZE bytes on the
+ * caller's stack; everything streamed into it is collected there and
+ * handed to the logger as one line at the end of the statement, so lines
+ * of different threads never interleave. Arguments that don't fit are
+ * cut (the last byte is kept for endl); the record needs no allocation.
+ *
+ * Levels below LOG_MIN_LEVEL compile to nothing; levels below setLevel
+ * are skipped with one relaxed load, before any argument is evaluated.
+ *
+ * A Line doesn't format: it captures a record of its call site (pointers
+ * to the static file and function names) and its arguments in binary,
+ * i.e. integers and doubles as they are and strings as bytes. The record
+ * is formatted by whoever writes it; in async mode, that's the drain
+ * thread. Types without a binary form are formatted right away with
+ * their operator<<; endl ends the line, other manipulators are ignored.
+ *
+ * While a binary log is open (openBinary), records go to its file as they
+ * are instead of to cout; the calling thread copies them into the mapped
+ * file, with no formatting and no system call (see BinaryLog). LogDecoder
+ * renders the file in the usual text form.
+ *
+ * The logger owns one text sink: a stream (cout unless setStream says
+ * otherwise) and the lock that keeps its lines whole. Nothing else takes
+ * that lock, so a line is one lock hold and a statement never needs an
+ * outer lock to stay in one piece. Lines are written to the stream right
+ * away (and flushed) by default. Between startAsync and stopAsync, a
+ * thread only moves its line into its own ring, a single producer /
+ * single consumer queue, and a drain thread writes the lines of all
+ * rings to the stream in batches. Lines of one thread
+ * keep their order; lines of different threads are only roughly ordered.
+ *
+ * When a ring is full, Overflow::DROP drops the line and counts it, and
+ * Overflow::BLOCK waits for the drain thread to make room. Rings of exited
+ * threads are reused by new ones. Start and stop the async mode while no
+ * other thread logs; stopAsync writes all pending lines before it
+ * returns, and so does the logger at exit.
+ */
 class Logger
 {
 public:
-    enum class Level : unsigned int { INF, WRN, ERR };
+    enum class Level    : unsigned int { INF, WRN, ERR };
+    enum class Overflow : unsigned int { DROP, BLOCK };
+
+    struct Stats
+    {
+        uint64_t    written;    // lines written to the stream
+        uint64_t    dropped;    // lines dropped on full rings
+        uint64_t    blocked;    // lines that waited for room in their ring
+    };
 
-    static inline ostream& log( const Level  level,
-                                const char*  file,
-                                const char*  func,
-                                unsigned int line )
+    /* Call site of a record; names are string literals, so pointers do */
+    struct Site
     {
-        string strLogLvl;
+        Level           level;
+        unsigned int    line;
+        const char*     file;
+        const char*     func;
+    };
 
-        switch ( level )
+    /* Tags of the arguments of a record */
+    enum Tag : char { SIGNED, UNSIGNED, FLOATING, CHARACTER, TEXT, NEWLINE };
+
+    /* One line; handed to the logger when it goes out of scope */
+    class Line
+    {
+    public:
+        Line( const Level level, const char* file, const char* func, unsigned int line ) :
+            _size{ sizeof( Site ) }, _isActive{ true }
         {
-            case Level::INF:
-                strLogLvl = "[INF]";
-                break;
+            const Site site{ level, line, file, func };
+
+            memcpy( _record, &site, sizeof( site ) );
+        }
 
-            case Level::WRN:
-                strLogLvl = "[WRN]";
-                break;
+        Line( Line&& other ) : _size{ other._size }, _isActive{ other._isActive }
+        {
+            memcpy( _record, other._record, _size );
+            other._isActive = false;
+        }
 
-            case Level::ERR:
-                strLogLvl = "[ERR]";
-                break;
+        ~Line()
+        {
+            if ( _isActive ) submit( _record, _size );
         }
 
-        cout << strLogLvl << " : "
-             << file << ": " << func << "(): " << line << ": ";
+        Line& operator<<( const char* value )           { return putText( value, strlen( value ) ); }
+        Line& operator<<( const string& value )         { return putText( value.data(), value.size() ); }
+        Line& operator<<( const char value )            { return put( CHARACTER, value ); }
+        Line& operator<<( const bool value )            { return put( UNSIGNED, (uint64_t) value ); }
+        Line& operator<<( const short value )           { return put( SIGNED, (int64_t) value ); }
+        Line& operator<<( const int value )             { return put( SIGNED, (int64_t) value ); }
+        Line& operator<<( const long value )            { return put( SIGNED, (int64_t) value ); }
+        Line& operator<<( const long long value )       { return put( SIGNED, (int64_t) value ); }
+        Line& operator<<( const unsigned short value )  { return put( UNSIGNED, (uint64_t) value ); }
+        Line& operator<<( const unsigned int value )    { return put( UNSIGNED, (uint64_t) value ); }
+        Line& operator<<( const unsigned long value )   { return put( UNSIGNED, (uint64_t) value ); }
+        Line& operator<<( const unsigned long long value ) { return put( UNSIGNED, (uint64_t) value ); }
+        Line& operator<<( const float value )           { return put( FLOATING, (double) value ); }
+        Line& operator<<( const double value )          { return put( FLOATING, value ); }
+
+        /* No binary form; format now */
+        template < typename T >
+        Line& operator<<( const T& value )
+        {
+            std::ostringstream stream;
+
+            stream << value;
+
+            return *this << stream.str();
+        }
+
+        /* endl ends the line; flush and other manipulators have no effect */
+        Line& operator<<( ostream& ( *manipulator )( ostream& ) )
+        {
+            if ( manipulator == (ostream& ( * )( ostream& )) std::endl && _size < LOG_RECORD_SIZE )
+            {
+                _record[ _size++ ] = NEWLINE;
+            }
+
+            return *this;
+        }
+
+    private:
+        template < typename T >
+        Line& put( const Tag tag, const T value )
+        {
+            /* Keep the last byte for endl */
+            if ( _size + 1 + sizeof( value ) >= LOG_RECORD_SIZE ) return *this;
+
+            _record[ _size ] = tag;
+            memcpy( _record + _size + 1, &value, sizeof( value ) );
+            _size += 1 + sizeof( value );
+
+            return *this;
+        }
 
-        return cout;
+        Line& putText( const char* text, size_t length )
+        {
+            if ( _size + 1 + sizeof( uint32_t ) >= LOG_RECORD_SIZE - 1 ) return *this;
+
+            /* Cut what doesn't fit */
+            length = std::min( length, LOG_RECORD_SIZE - 1 - _size - 1 - sizeof( uint32_t ) );
+
+            put( TEXT, (uint32_t) length );
+            memcpy( _record + _size, text, length );
+            _size += length;
+
+            return *this;
+        }
+
+        char        _record[ LOG_RECORD_SIZE ];
+        size_t      _size;
+        bool        _isActive;     // false once moved from
+    };
+
+    /* Ends a log statement; binds looser than <<, so it takes the whole line */
+    struct Voidify
+    {
+        void operator&( const Line& ) const {}
+    };
+
+    static inline Line log( const Level  level,
+                            const char*  file,
+                            const char*  func,
+                            unsigned int line )
+    {
+        return Line( level, file, func, line );
+    }
+
+    static inline bool isEnabled( const Level level )
+    {
+        return ( (unsigned int) level >= LOG_MIN_LEVEL &&
+                 (unsigned int) level >= _level.load( std::memory_order_relaxed ) );
     }
+
+    static void setLevel( const Level level );
+
+    /* Text of a record, appended to text */
+    static void format( const char* record, const size_t size, string& text );
+
+    /* Stream lines are written to; cout by default. The stream must outlive its use */
+    static void setStream( ostream& stream );
+
+    static bool startAsync( const size_t capacity = LOG_RING_CAPACITY, const Overflow overflow = Overflow::DROP );
+    static void stopAsync ( void );
+
+    static bool openBinary ( const char* path, const size_t bytes = LOG_BINARY_SIZE );
+    static bool closeBinary( void );
+
+    static Stats stats( void );
+
+private:
+    struct Ring;
+    struct State;
+    struct ThreadRing;
+
+    static State& state     ( void );
+    static Ring&  threadRing( void );
+    static size_t drainRings( string& batch );
+    static void   drain     ( void );
+    static void   submit    ( const char* record, const size_t size );
+
+    static std::atomic< unsigned int >  _level;     // lowest level written
 };
 
 
@@ -0,0 +1,49 @@
+#ifndef MAP_ENGINE_HPP_
+#define MAP_ENGINE_HPP_
+
+#include "hashmap.hpp"
+#include "flat_hashmap.hpp"
+#include "lockfree_hashmap.hpp"
+#include "sharded_hashmap.hpp"
+
+
+namespace HashMapTest {
+
+/* Hash map engines */
+enum class MapEngine { CHAINED, FLAT, LOCK_FREE, SHARDED };
+
+template < MapEngine E, typename K, typename V, typename F >
+struct MapEngineSelector;
+
+template < typename K, typename V, typename F >
+struct MapEngineSelector< MapEngine::CHAINED, K, V, F >
+{
+    typedef TSHashMap< K, V, F > type;
+};
+
+template < typename K, typename V, typename F >
+struct MapEngineSelector< MapEngine::FLAT, K, V, F >
+{
+    typedef TSFlatHashMap< K, V, F > type;
+};
+
+template < typename K, typename V, typename F >
+struct MapEngineSelector< MapEngine::LOCK_FREE, K, V, F >
+{
+    typedef LockFreeHashMap< K, V, F > type;
+};
+
+template < typename K, typename V, typename F >
+struct MapEngineSelector< MapEngine::SHARDED, K, V, F >
+{
+    typedef ShardedHashMap< K, V, F > type;
+};
+
+/* Thread-safe hash map with engine selected at compile time */
+template < typename K, typename V, MapEngine E = MapEngine::CHAINED, typename F = DefaultHashFunction< K > >
+using TSMap = typename MapEngineSelector< E, K, V, F >::type;
+
+} // HashMapTest
+
+
+#endif /* MAP_ENGINE_HPP_ */
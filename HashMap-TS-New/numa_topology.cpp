@@ -0,0 +1,223 @@
+#include <thread>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "numa_topology.hpp"
+
+
+namespace HashMapTest {
+
+using std::vector;
+using std::string;
+using std::memory_order_relaxed;
+
+/* mbind policy and flags, as in numaif.h */
+const int           MBIND_PREFERRED = 1;
+const unsigned int  MBIND_MOVE      = 1 << 1;
+
+size_t NumaTopology::nodes( void )
+{
+    return topology().cpus.size();
+}
+
+int NumaTopology::nodeOfCpu( const size_t cpu )
+{
+    const Topology& thisTopology = topology();
+
+    for ( size_t node = 0; node < thisTopology.cpus.size(); ++node )
+    {
+        for ( const size_t nodeCpu : thisTopology.cpus[ node ] )
+        {
+            if ( nodeCpu == cpu ) return (int) node;
+        }
+    }
+
+    return NUMA_NO_NODE;
+}
+
+int NumaTopology::currentNode( void )
+{
+    /* Threads bound to a node stay there */
+    if ( threadNode() != NUMA_NO_NODE ) return threadNode();
+
+    const int cpu = sched_getcpu();
+    if ( cpu < 0 ) return 0;
+
+    const int node = nodeOfCpu( cpu );
+    return ( node != NUMA_NO_NODE ) ? node : 0;
+}
+
+bool NumaTopology::bindThread( const int node )
+{
+    const Topology& thisTopology = topology();
+
+    if ( node < 0 || (size_t) node >= thisTopology.cpus.size() ) return false;
+
+    threadNode() = node;
+
+    /* Simulated nodes share the real CPUs; only remember the node */
+    if ( thisTopology.simulated > 0 ) return true;
+
+    cpu_set_t cpus;
+    CPU_ZERO( &cpus );
+    for ( const size_t cpu : thisTopology.cpus[ node ] ) CPU_SET( cpu, &cpus );
+
+    return ( sched_setaffinity( 0, sizeof( cpus ), &cpus ) == 0 );
+}
+
+bool NumaTopology::bindMemory( void* address, const size_t length, const int node )
+{
+    Topology& thisTopology = topology();
+
+    if ( !address || length == 0 || node < 0 || (size_t) node >= thisTopology.cpus.size() ) return false;
+
+    thisTopology.boundBytes.fetch_add( length, memory_order_relaxed );
+
+    /* Nothing to place on simulated or single node hosts */
+    if ( thisTopology.simulated > 0 || thisTopology.cpus.size() == 1 ) return true;
+
+#ifdef SYS_mbind
+    /* Whole pages covering the range */
+    const uintptr_t page  = pageSize();
+    const uintptr_t start = (uintptr_t) address & ~( page - 1 );
+    const uintptr_t end   = ( (uintptr_t) address + length + page - 1 ) & ~( page - 1 );
+
+    unsigned long nodeMask[ 16 ] = {};
+    const size_t  maskBits       = sizeof( nodeMask[ 0 ] ) * 8;
+
+    if ( (size_t) node >= sizeof( nodeMask ) * 8 ) return false;
+
+    nodeMask[ node / maskBits ] |= 1UL << ( node % maskBits );
+
+    if ( syscall( SYS_mbind, start, end - start, MBIND_PREFERRED, nodeMask, sizeof( nodeMask ) * 8, MBIND_MOVE ) != 0 )
+    {
+        thisTopology.failedBinds.fetch_add( 1, memory_order_relaxed );
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+void NumaTopology::simulate( const size_t nodes )
+{
+    load( topology(), nodes );
+}
+
+bool NumaTopology::isSimulated( void )
+{
+    return ( topology().simulated > 0 );
+}
+
+size_t NumaTopology::pageSize( void )
+{
+    static const size_t size = sysconf( _SC_PAGESIZE ) > 0 ? sysconf( _SC_PAGESIZE ) : 4096;
+
+    return size;
+}
+
+NumaTopology::Stats NumaTopology::stats( void )
+{
+    const Topology& thisTopology = topology();
+
+    return Stats{ thisTopology.boundBytes.load( memory_order_relaxed ),
+                  thisTopology.failedBinds.load( memory_order_relaxed ) };
+}
+
+void NumaTopology::resetStats( void )
+{
+    Topology& thisTopology = topology();
+
+    thisTopology.boundBytes.store( 0, memory_order_relaxed );
+    thisTopology.failedBinds.store( 0, memory_order_relaxed );
+}
+
+NumaTopology::Topology& NumaTopology::topology( void )
+{
+    static Topology* thisTopology = []()
+    {
+        Topology* newTopology = new Topology;
+
+        newTopology->boundBytes  = 0;
+        newTopology->failedBinds = 0;
+
+        /* Real topology until simulated */
+        load( *newTopology, 0 );
+
+        return newTopology;
+    }();
+
+    return *thisTopology;
+}
+
+void NumaTopology::load( Topology& thisTopology, const size_t nodes )
+{
+    const size_t nCpus = std::max< size_t >( std::thread::hardware_concurrency(), 1 );
+
+    thisTopology.cpus.clear();
+    thisTopology.simulated = nodes;
+
+    if ( nodes > 0 )
+    {
+        /* Deal CPUs to simulated nodes; a node may have none */
+        thisTopology.cpus.resize( nodes );
+        for ( size_t cpu = 0; cpu < nCpus; ++cpu ) thisTopology.cpus[ cpu % nodes ].push_back( cpu );
+
+        return;
+    }
+
+    /* Online nodes and their CPUs; memory only nodes have none */
+    for ( const size_t node : parseList( "/sys/devices/system/node/online" ) )
+    {
+        const string path = "/sys/devices/system/node/node" + std::to_string( node ) + "/cpulist";
+
+        if ( node >= thisTopology.cpus.size() ) thisTopology.cpus.resize( node + 1 );
+        thisTopology.cpus[ node ] = parseList( path.c_str() );
+    }
+
+    /* No sysfs; a single node with all CPUs */
+    if ( thisTopology.cpus.empty() )
+    {
+        thisTopology.cpus.resize( 1 );
+        for ( size_t cpu = 0; cpu < nCpus; ++cpu ) thisTopology.cpus[ 0 ].push_back( cpu );
+    }
+}
+
+int& NumaTopology::threadNode( void )
+{
+    static thread_local int node = NUMA_NO_NODE;
+
+    return node;
+}
+
+vector< size_t > NumaTopology::parseList( const char* path )
+{
+    vector< size_t > cpus;
+    std::ifstream    file( path );
+    string           list;
+
+    if ( !file || !std::getline( file, list ) ) return cpus;
+
+    /* Comma separated ids and ranges, e.g. "0-3,8-11" */
+    std::stringstream stream( list );
+    string            range;
+
+    while ( std::getline( stream, range, ',' ) )
+    {
+        if ( range.empty() ) continue;
+
+        const size_t dash  = range.find( '-' );
+        const size_t first = std::stoul( range.substr( 0, dash ) );
+        const size_t last  = ( dash == string::npos ) ? first : std::stoul( range.substr( dash + 1 ) );
+
+        for ( size_t cpu = first; cpu <= last; ++cpu ) cpus.push_back( cpu );
+    }
+
+    return cpus;
+}
+
+} // HashMapTest
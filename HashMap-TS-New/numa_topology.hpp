@@ -0,0 +1,73 @@
+#ifndef NUMA_TOPOLOGY_HPP_
+#define NUMA_TOPOLOGY_HPP_
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+namespace HashMapTest {
+
+const int NUMA_NO_NODE = -1;
+
+/*
+ * NUMA nodes of the host, read from sysfs, and placement of threads and
+ * memory on them. Memory is bound with the mbind system call (preferred
+ * policy, existing pages moved), so there's no libnuma dependency; where
+ * mbind is missing (or on a single node host) binding is a no-op.
+ *
+ * bindMemory binds whole pages; pages that the range only partly covers
+ * are bound as well, so allocations meant for different nodes should not
+ * share pages (see PoolAllocator::setNode).
+ *
+ * Simulation mode pretends there are the given number of nodes, with CPUs
+ * dealt to them in round robin. Threads bound to a node only remember it,
+ * and memory binding is only counted, so placement logic can be exercised
+ * and benchmarked on a single node box. Switch modes before any map uses
+ * the topology.
+ */
+class NumaTopology
+{
+public:
+    struct Stats
+    {
+        uint64_t    boundBytes;     // bytes bound to a node
+        uint64_t    failedBinds;    // mbind calls that failed
+    };
+
+    static size_t nodes      ( void );
+    static int    nodeOfCpu  ( const size_t cpu );
+    static int    currentNode( void );
+
+    static bool bindThread( const int node );
+    static bool bindMemory( void* address, const size_t length, const int node );
+
+    static void simulate   ( const size_t nodes );
+    static bool isSimulated( void );
+
+    static size_t pageSize( void );
+
+    static Stats stats     ( void );
+    static void  resetStats( void );
+
+private:
+    struct Topology
+    {
+        std::vector< std::vector< size_t > >    cpus;       // CPUs of every node
+        size_t                                  simulated;  // simulated nodes, 0 if real
+        std::atomic< uint64_t >                 boundBytes;
+        std::atomic< uint64_t >                 failedBinds;
+    };
+
+    static Topology& topology  ( void );
+    static void      load      ( Topology& thisTopology, const size_t nodes );
+    static int&      threadNode( void );
+
+    static std::vector< size_t > parseList( const char* path );
+};
+
+} // HashMapTest
+
+
+#endif /* NUMA_TOPOLOGY_HPP_ */
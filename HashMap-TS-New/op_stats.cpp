@@ -0,0 +1,337 @@
+#include <algorithm>
+#include "op_stats.hpp"
+
+
+namespace HashMapTest {
+
+using std::max;
+using std::lock_guard;
+using std::memory_order_relaxed;
+using std::memory_order_acquire;
+using std::memory_order_release;
+
+/* Percentiles written by writeJson */
+const double JSON_QUANTILES[]    = { 0.5, 0.9, 0.99, 0.999 };
+const char*  JSON_PERCENTILES[]  = { "p50", "p90", "p99", "p999" };
+
+void Histogram::record( const uint64_t value )
+{
+    counts[ bucketOf( value ) ]++;
+    count++;
+    sum += value;
+    max  = std::max( max, value );
+}
+
+uint64_t Histogram::percentile( const double quantile ) const
+{
+    if ( count == 0 ) return 0;
+
+    /* Rank of the value; at least the first one */
+    const uint64_t rank = std::max< uint64_t >( 1, (uint64_t) ( quantile * count + 0.5 ) );
+    uint64_t       seen = 0;
+
+    for ( size_t bucket = 0; bucket < HISTOGRAM_BUCKETS; ++bucket )
+    {
+        seen += counts[ bucket ];
+        if ( seen >= rank ) return std::min( highestOf( bucket ), max );
+    }
+
+    return max;
+}
+
+double Histogram::mean( void ) const
+{
+    return ( count > 0 ) ? (double) sum / count : 0;
+}
+
+Histogram& Histogram::operator+=( const Histogram& other )
+{
+    for ( size_t bucket = 0; bucket < HISTOGRAM_BUCKETS; ++bucket ) counts[ bucket ] += other.counts[ bucket ];
+
+    count += other.count;
+    sum   += other.sum;
+    max    = std::max( max, other.max );
+
+    return *this;
+}
+
+size_t Histogram::bucketOf( const uint64_t value )
+{
+    if ( value < HISTOGRAM_SUB_BUCKETS ) return (size_t) value;
+
+    /* Power of two, then the linear sub-bucket below the leading bit */
+    const unsigned int exponent = 63 - __builtin_clzll( value );
+    const unsigned int shift    = exponent - HISTOGRAM_SUB_BITS;
+
+    return ( shift + 1 ) * HISTOGRAM_SUB_BUCKETS + (size_t) ( ( value >> shift ) & ( HISTOGRAM_SUB_BUCKETS - 1 ) );
+}
+
+uint64_t Histogram::highestOf( const size_t bucket )
+{
+    if ( bucket < HISTOGRAM_SUB_BUCKETS ) return bucket;
+
+    const unsigned int shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+    const uint64_t     lowest = ( (uint64_t) HISTOGRAM_SUB_BUCKETS + bucket % HISTOGRAM_SUB_BUCKETS ) << shift;
+
+    return lowest + ( ( (uint64_t) 1 << shift ) - 1 );
+}
+
+OpStats::Snapshot& OpStats::Snapshot::operator+=( const Snapshot& other )
+{
+    isEnabled = isEnabled || other.isEnabled;
+
+    for ( unsigned int metric = 0; metric < METRICS; ++metric ) metrics[ metric ] += other.metrics[ metric ];
+
+    return *this;
+}
+
+void OpStats::Snapshot::writeJson( std::ostream& stream ) const
+{
+    stream << "{\"enabled\": " << ( isEnabled ? "true" : "false" );
+
+    for ( unsigned int metric = 0; isEnabled && metric < METRICS; ++metric )
+    {
+        const Histogram& histogram = metrics[ metric ];
+
+        stream << ", \"" << nameOf( (Metric) metric ) << "\": {\"count\": " << histogram.count
+               << ", \"mean\": " << histogram.mean() << ", \"max\": " << histogram.max;
+
+        for ( size_t i = 0; i < sizeof( JSON_QUANTILES ) / sizeof( JSON_QUANTILES[ 0 ] ); ++i )
+        {
+            stream << ", \"" << JSON_PERCENTILES[ i ] << "\": " << histogram.percentile( JSON_QUANTILES[ i ] );
+        }
+
+        stream << "}";
+    }
+
+    stream << "}";
+}
+
+const char* OpStats::nameOf( const Metric metric )
+{
+    switch ( metric )
+    {
+        case ADD:           return "add";
+        case DEL:           return "del";
+        case FIND:          return "find";
+        case RESIZE:        return "resize";
+        case READ_WAIT:     return "readWait";
+        case WRITE_WAIT:    return "writeWait";
+        case CHAIN:         return "chain";
+        default:            return "unknown";
+    }
+}
+
+#if HASHMAP_INSTRUMENT
+
+OpStats::OpStats() : _id{ nextId() }, _records{ nullptr }
+{
+    Registry& stats = registry();
+
+    lock_guard< std::mutex > lock( stats.mutex );
+    stats.ids.insert( _id );
+}
+
+OpStats::~OpStats()
+{
+    /* Threads forget records of stats that are gone on their next miss */
+    {
+        Registry& stats = registry();
+
+        lock_guard< std::mutex > lock( stats.mutex );
+        stats.ids.erase( _id );
+    }
+
+    ThreadRecord* record = _records.load();
+    while ( record )
+    {
+        ThreadRecord* next = record->next;
+        delete record;
+        record = next;
+    }
+}
+
+void OpStats::record( const Metric metric, const uint64_t value )
+{
+    /* Thread is exiting and gave its records back */
+    if ( isCacheGone() ) return;
+
+    ThreadRecord& thisRecord = threadRecord();
+
+    /* Owner is the only writer; no read-modify-write needed */
+    std::atomic< uint64_t >& count = thisRecord.counts[ metric ][ Histogram::bucketOf( value ) ];
+    count.store( count.load( memory_order_relaxed ) + 1, memory_order_relaxed );
+
+    std::atomic< uint64_t >& sum = thisRecord.sums[ metric ];
+    sum.store( sum.load( memory_order_relaxed ) + value, memory_order_relaxed );
+
+    if ( value > thisRecord.maxes[ metric ].load( memory_order_relaxed ) )
+    {
+        thisRecord.maxes[ metric ].store( value, memory_order_relaxed );
+    }
+}
+
+OpStats::Snapshot OpStats::snapshot( void ) const
+{
+    Snapshot snapshot{};
+
+    snapshot.isEnabled = true;
+
+    for ( ThreadRecord* record = _records.load( memory_order_acquire ); record; record = record->next )
+    {
+        for ( unsigned int metric = 0; metric < METRICS; ++metric )
+        {
+            Histogram& histogram = snapshot.metrics[ metric ];
+
+            for ( size_t bucket = 0; bucket < HISTOGRAM_BUCKETS; ++bucket )
+            {
+                const uint64_t count = record->counts[ metric ][ bucket ].load( memory_order_relaxed );
+
+                histogram.counts[ bucket ] += count;
+                histogram.count            += count;
+            }
+
+            histogram.sum += record->sums[ metric ].load( memory_order_relaxed );
+            histogram.max  = max( histogram.max, record->maxes[ metric ].load( memory_order_relaxed ) );
+        }
+    }
+
+    return snapshot;
+}
+
+void OpStats::reset( void )
+{
+    /* Racy with concurrent recording; meant for quiet phases */
+    for ( ThreadRecord* record = _records.load( memory_order_acquire ); record; record = record->next )
+    {
+        for ( unsigned int metric = 0; metric < METRICS; ++metric )
+        {
+            for ( auto& count : record->counts[ metric ] ) count.store( 0, memory_order_relaxed );
+
+            record->sums [ metric ].store( 0, memory_order_relaxed );
+            record->maxes[ metric ].store( 0, memory_order_relaxed );
+        }
+    }
+}
+
+OpStats::Registry& OpStats::registry( void )
+{
+    static Registry stats;
+    return stats;
+}
+
+OpStats::ThreadCache::~ThreadCache()
+{
+    isCacheGone() = true;
+
+    /* Give records back to stats that are still alive */
+    for ( const auto& entry : entries ) release( entry );
+}
+
+OpStats::ThreadCache& OpStats::threadCache( void )
+{
+    static thread_local ThreadCache cache{};
+    return cache;
+}
+
+bool& OpStats::isCacheGone( void )
+{
+    /* Trivially destructible, so still readable after the cache is destroyed */
+    static thread_local bool isGone = false;
+    return isGone;
+}
+
+uint64_t OpStats::nextId( void )
+{
+    static std::atomic< uint64_t > lastId{ 0 };
+    return ++lastId;
+}
+
+void OpStats::release( const CacheEntry& entry )
+{
+    Registry& stats = registry();
+
+    lock_guard< std::mutex > lock( stats.mutex );
+
+    /* Records of destroyed stats were freed along with them */
+    if ( stats.ids.count( entry.statsId ) )
+    {
+        entry.record->inUse.store( false, memory_order_release );
+    }
+}
+
+OpStats::ThreadRecord& OpStats::threadRecord( void )
+{
+    ThreadCache& cache = threadCache();
+
+    /* Most threads use one map at a time */
+    if ( cache.last < cache.entries.size() && cache.entries[ cache.last ].statsId == _id )
+    {
+        return *cache.entries[ cache.last ].record;
+    }
+
+    for ( size_t i = 0; i < cache.entries.size(); ++i )
+    {
+        if ( cache.entries[ i ].statsId == _id )
+        {
+            cache.last = i;
+            return *cache.entries[ i ].record;
+        }
+    }
+
+    /* First use by this thread; forget stats that are gone */
+    {
+        Registry& stats = registry();
+
+        lock_guard< std::mutex > lock( stats.mutex );
+
+        cache.entries.erase( std::remove_if( cache.entries.begin(), cache.entries.end(),
+                                             [ &stats ]( const CacheEntry& entry )
+                                             {
+                                                 return !stats.ids.count( entry.statsId );
+                                             } ),
+                             cache.entries.end() );
+    }
+
+    ThreadRecord* record = acquire();
+
+    cache.entries.push_back( CacheEntry{ _id, record } );
+    cache.last = cache.entries.size() - 1;
+
+    return *record;
+}
+
+OpStats::ThreadRecord* OpStats::acquire( void )
+{
+    /* Reuse a record of an exited thread; its counts stay in the totals */
+    for ( ThreadRecord* record = _records.load( memory_order_acquire ); record; record = record->next )
+    {
+        bool isInUse = false;
+        if ( !record->inUse.load( memory_order_relaxed ) &&
+             record->inUse.compare_exchange_strong( isInUse, true, memory_order_acquire ) )
+        {
+            return record;
+        }
+    }
+
+    ThreadRecord* record = new ThreadRecord();
+
+    for ( unsigned int metric = 0; metric < METRICS; ++metric )
+    {
+        for ( auto& count : record->counts[ metric ] ) count.store( 0, memory_order_relaxed );
+
+        record->sums [ metric ].store( 0, memory_order_relaxed );
+        record->maxes[ metric ].store( 0, memory_order_relaxed );
+    }
+
+    record->inUse = true;
+    record->next  = _records.load( memory_order_relaxed );
+
+    while ( !_records.compare_exchange_weak( record->next, record, memory_order_release, memory_order_relaxed ) );
+
+    return record;
+}
+
+#endif
+
+} // HashMapTest
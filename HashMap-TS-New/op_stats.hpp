@@ -0,0 +1,169 @@
+#ifndef OP_STATS_HPP_
+#define OP_STATS_HPP_
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <ostream>
+#include <unordered_set>
+
+/* Build with -DHASHMAP_INSTRUMENT=1 to record operation stats; off by default */
+#ifndef HASHMAP_INSTRUMENT
+#define HASHMAP_INSTRUMENT 0
+#endif
+
+
+namespace HashMapTest {
+
+const unsigned int HISTOGRAM_SUB_BITS    = 4;   // linear sub-buckets per power of two, as bits
+const unsigned int HISTOGRAM_SUB_BUCKETS = 1 << HISTOGRAM_SUB_BITS;
+const unsigned int HISTOGRAM_BUCKETS     = ( 64 - HISTOGRAM_SUB_BITS + 1 ) * HISTOGRAM_SUB_BUCKETS;
+const unsigned int OP_STATS_PADDING      = 64;  // cache line size
+
+/*
+ * Log-linear histogram in the style of HdrHistogram: values below
+ * HISTOGRAM_SUB_BUCKETS are counted exactly, larger ones in one of
+ * HISTOGRAM_SUB_BUCKETS linear buckets per power of two, so percentiles
+ * are off by at most 1 / HISTOGRAM_SUB_BUCKETS of the value (6.25%).
+ * Percentiles report the highest value of their bucket.
+ */
+struct Histogram
+{
+    uint64_t    counts[ HISTOGRAM_BUCKETS ];
+    uint64_t    count;
+    uint64_t    sum;
+    uint64_t    max;
+
+    void     record    ( const uint64_t value );
+    uint64_t percentile( const double quantile ) const;
+    double   mean      ( void ) const;
+
+    Histogram& operator+=( const Histogram& other );
+
+    static size_t   bucketOf   ( const uint64_t value );
+    static uint64_t highestOf  ( const size_t bucket );
+};
+
+/*
+ * Per-operation stats of a map:
+ *
+ *  ADD, DEL, FIND  - latency of single key operations, in ns, including
+ *                    waits for locks and resizes they trigger
+ *  RESIZE          - time all stripes were held to start a resize, in ns
+ *  READ_WAIT       - time spent acquiring a stripe's read lock, in ns
+ *  WRITE_WAIT      - time spent acquiring a stripe's write lock, in ns
+ *  CHAIN           - entries walked past in a chain by add / del / find
+ *
+ * Batch operations only count lock waits and chains.
+ *
+ * Every thread records into its own set of histograms, made on first use,
+ * so recording never touches a line another thread writes. A thread gives
+ * its set back when it exits, and a new thread reuses it, counts and all,
+ * so the sets are bounded by the live threads and no count is lost. Once
+ * a thread's records are given back (e.g. global maps destroyed after the
+ * main thread's), it records nothing more.
+ * snapshot merges all of them on demand; it may miss values recorded
+ * concurrently, but never tears one.
+ *
+ * With HASHMAP_INSTRUMENT 0, OpStats records nothing and now() doesn't
+ * read the clock, so all calls compile away; snapshots are empty.
+ */
+class OpStats
+{
+public:
+    enum Metric : unsigned int { ADD, DEL, FIND, RESIZE, READ_WAIT, WRITE_WAIT, CHAIN, METRICS };
+
+    struct Snapshot
+    {
+        bool        isEnabled;
+        Histogram   metrics[ METRICS ];
+
+        Snapshot& operator+=( const Snapshot& other );
+
+        void writeJson( std::ostream& stream ) const;
+    };
+
+    static const char* nameOf( const Metric metric );
+
+#if HASHMAP_INSTRUMENT
+    OpStats();
+
+    ~OpStats();
+
+    OpStats( const OpStats& ) = delete;
+    OpStats& operator=( const OpStats& ) = delete;
+
+    static uint64_t now( void )
+    {
+        return std::chrono::duration_cast< std::chrono::nanoseconds >(
+            std::chrono::steady_clock::now().time_since_epoch() ).count();
+    }
+
+    /* Elapsed time since start, as returned by now() */
+    void recordSince( const Metric metric, const uint64_t start ) { record( metric, now() - start ); }
+
+    void record( const Metric metric, const uint64_t value );
+
+    Snapshot snapshot( void ) const;
+    void     reset   ( void );
+
+private:
+    /* One thread's histograms; written by its owner only */
+    struct ThreadRecord
+    {
+        std::atomic< uint64_t >     counts[ METRICS ][ HISTOGRAM_BUCKETS ];
+        std::atomic< uint64_t >     sums  [ METRICS ];
+        std::atomic< uint64_t >     maxes [ METRICS ];
+        std::atomic< bool >         inUse;      // owned by a thread
+        ThreadRecord*               next;
+        char                        padding[ OP_STATS_PADDING ];
+    };
+
+    struct CacheEntry
+    {
+        uint64_t        statsId;
+        ThreadRecord*   record;
+    };
+
+    struct ThreadCache
+    {
+        std::vector< CacheEntry >   entries;
+        size_t                      last;       // most recently used entry
+
+        ~ThreadCache();
+    };
+
+    struct Registry
+    {
+        std::mutex                      mutex;
+        std::unordered_set< uint64_t >  ids;    // stats still alive
+    };
+
+    static Registry&    registry   ( void );
+    static ThreadCache& threadCache( void );
+    static bool&        isCacheGone( void );
+    static uint64_t     nextId     ( void );
+
+    static void release( const CacheEntry& entry );
+
+    ThreadRecord& threadRecord( void );
+    ThreadRecord* acquire     ( void );
+
+    const uint64_t                  _id;
+    std::atomic< ThreadRecord* >    _records;   // push only; freed by destructor
+#else
+    static uint64_t now        ( void )                                     { return 0; }
+    void            recordSince( const Metric, const uint64_t )             {}
+    void            record     ( const Metric, const uint64_t )             {}
+
+    Snapshot snapshot( void ) const { return Snapshot{}; }
+    void     reset   ( void )       {}
+#endif
+};
+
+} // HashMapTest
+
+
+#endif /* OP_STATS_HPP_ */
@@ -0,0 +1,160 @@
+#ifndef PROBE_GROUP_HPP_
+#define PROBE_GROUP_HPP_
+
+#include <cstdint>
+#include <cstddef>
+
+#if defined( __SSE2__ ) || defined( __AVX2__ )
+#include <immintrin.h>
+#endif
+
+
+namespace HashMapTest {
+
+/* Control bytes of open addressing tables; full slots hold a 7-bit tag */
+const int8_t CONTROL_EMPTY   = -128;
+const int8_t CONTROL_DELETED = -2;
+
+/* Bit masks of a group have bit i set for matching control byte i */
+inline size_t lowestBit( const uint32_t bits )
+{
+    return __builtin_ctz( bits );
+}
+
+inline size_t highestBit( const uint32_t bits )
+{
+    return 31 - __builtin_clz( bits );
+}
+
+/*
+ * Probe groups load WIDTH consecutive control bytes and match them against
+ * a tag at once. All groups share the same interface, so tables can take
+ * any of them as a template parameter.
+ */
+
+/* Portable fallback; compares one control byte at a time */
+class ScalarProbeGroup
+{
+public:
+    enum { WIDTH = 16 };
+
+    explicit ScalarProbeGroup( const int8_t* control ) : _control{ control }
+    {
+    }
+
+    uint32_t match( const int8_t tag ) const
+    {
+        uint32_t bits = 0;
+
+        for ( size_t i = 0; i < WIDTH; ++i )
+        {
+            if ( _control[ i ] == tag ) bits |= ( 1u << i );
+        }
+
+        return bits;
+    }
+
+    uint32_t matchEmpty( void ) const
+    {
+        return match( CONTROL_EMPTY );
+    }
+
+    uint32_t matchEmptyOrDeleted( void ) const
+    {
+        uint32_t bits = 0;
+
+        for ( size_t i = 0; i < WIDTH; ++i )
+        {
+            if ( _control[ i ] < 0 ) bits |= ( 1u << i );
+        }
+
+        return bits;
+    }
+
+private:
+    const int8_t* _control;
+};
+
+#if defined( __SSE2__ )
+
+/* 16 control bytes per compare */
+class Sse2ProbeGroup
+{
+public:
+    enum { WIDTH = 16 };
+
+    explicit Sse2ProbeGroup( const int8_t* control ) :
+        _control{ _mm_loadu_si128( reinterpret_cast< const __m128i* >( control ) ) }
+    {
+    }
+
+    uint32_t match( const int8_t tag ) const
+    {
+        return (uint32_t) _mm_movemask_epi8( _mm_cmpeq_epi8( _control, _mm_set1_epi8( tag ) ) );
+    }
+
+    uint32_t matchEmpty( void ) const
+    {
+        return match( CONTROL_EMPTY );
+    }
+
+    uint32_t matchEmptyOrDeleted( void ) const
+    {
+        /* Empty and deleted are the only control bytes with sign bit set */
+        return (uint32_t) _mm_movemask_epi8( _control );
+    }
+
+private:
+    __m128i _control;
+};
+
+#endif /* __SSE2__ */
+
+#if defined( __AVX2__ )
+
+/* 32 control bytes per compare */
+class Avx2ProbeGroup
+{
+public:
+    enum { WIDTH = 32 };
+
+    explicit Avx2ProbeGroup( const int8_t* control ) :
+        _control{ _mm256_loadu_si256( reinterpret_cast< const __m256i* >( control ) ) }
+    {
+    }
+
+    uint32_t match( const int8_t tag ) const
+    {
+        return (uint32_t) _mm256_movemask_epi8( _mm256_cmpeq_epi8( _control, _mm256_set1_epi8( tag ) ) );
+    }
+
+    uint32_t matchEmpty( void ) const
+    {
+        return match( CONTROL_EMPTY );
+    }
+
+    uint32_t matchEmptyOrDeleted( void ) const
+    {
+        /* Empty and deleted are the only control bytes with sign bit set */
+        return (uint32_t) _mm256_movemask_epi8( _control );
+    }
+
+private:
+    __m256i _control;
+};
+
+#endif /* __AVX2__ */
+
+/* Widest probe group available for the target instruction set */
+#if defined( __AVX2__ )
+typedef Avx2ProbeGroup   DefaultProbeGroup;
+#elif defined( __SSE2__ )
+typedef Sse2ProbeGroup   DefaultProbeGroup;
+#else
+typedef ScalarProbeGroup DefaultProbeGroup;
+#endif
+
+} // HashMapTest
+
+
+#endif /* PROBE_GROUP_HPP_ */
@@ -1,11 +1,36 @@
+#include <chrono>
+#include <algorithm>
 #include "read_write_lock.hpp"
 
 
 namespace HashMapTest {
 
+using std::max;
 using std::unique_lock;
+using std::lock_guard;
+using std::chrono::steady_clock;
+using std::chrono::nanoseconds;
+using std::chrono::duration_cast;
+using std::memory_order_relaxed;
+using std::memory_order_release;
 
-ReadWriteLock::ReadWriteLock() : _nReaders{ 0 }, _nWriters{ 0 }, _active{ 0 }
+ReadWriteLock::Stats& ReadWriteLock::Stats::operator+=( const Stats& other )
+{
+    readAcquires  += other.readAcquires;
+    writeAcquires += other.writeAcquires;
+    readWaits     += other.readWaits;
+    writeWaits    += other.writeWaits;
+    readWaitNs    += other.readWaitNs;
+    writeWaitNs   += other.writeWaitNs;
+    maxReadQueue   = max( maxReadQueue,  other.maxReadQueue  );
+    maxWriteQueue  = max( maxWriteQueue, other.maxWriteQueue );
+
+    return *this;
+}
+
+ReadWriteLock::ReadWriteLock( const Policy policy ) :
+    _nReaders{ 0 }, _nWriters{ 0 }, _active{ 0 }, _policy{ policy },
+    _nextTicket{ 0 }, _grantTicket{ 0 }, _nGranted{ 0 }, _stats{}
 {
 }
 
@@ -13,24 +38,43 @@ void ReadWriteLock::readLock ( void )
 {
     unique_lock< mutex > lock( _mutex );        // Acquire lock for condition variable
     ++_nReaders;                                // Increment number of readers
-    while ( _active < 0 || _nWriters > 0 )      // LOOP: To avoid spurious wake-ups
+    const uint64_t ticket = _nextTicket++;      // Take arrival order ticket
+    if ( isReaderBlocked( ticket ) )            // IF: Reader has to wait?
     {
-        _rCondVar.wait( lock );                 // Wait for the notification to read
+        ++_stats.readWaits;                     //     Count wait and queue depth
+        _stats.maxReadQueue = max< uint64_t >( _stats.maxReadQueue, _nReaders );
+        const auto start = steady_clock::now();
+        while ( isReaderBlocked( ticket ) )     // LOOP: To avoid spurious wake-ups
+        {
+            _rCondVar.wait( lock );             // Wait for the notification to read
+        }
+        _stats.readWaitNs += duration_cast< nanoseconds >( steady_clock::now() - start ).count();
+        if ( ticket < _grantTicket && _nGranted > 0 )
+            --_nGranted;                        // Granted reader entered
     }
     --_nReaders;                                // Decrement number of readers
     ++_active;                                  // Increment active status; block writers
+    ++_stats.readAcquires;
 }
 
 void ReadWriteLock::writeLock( void )
 {
     unique_lock< mutex > lock( _mutex );        // Acquire lock for condition variable
     ++_nWriters;                                // Increment number of writers
-    while ( _active != 0 )                      // LOOP: To avoid spurious wake-ups,
-    {                                           //       while there's reader(s) reading
-        _wCondVar.wait( lock );                 // Wait for the notification to write
+    if ( isWriterBlocked() )                    // IF: Writer has to wait?
+    {
+        ++_stats.writeWaits;                    //     Count wait and queue depth
+        _stats.maxWriteQueue = max< uint64_t >( _stats.maxWriteQueue, _nWriters );
+        const auto start = steady_clock::now();
+        while ( isWriterBlocked() )             // LOOP: To avoid spurious wake-ups,
+        {                                       //       while there's reader(s) reading
+            _wCondVar.wait( lock );             // Wait for the notification to write
+        }
+        _stats.writeWaitNs += duration_cast< nanoseconds >( steady_clock::now() - start ).count();
     }
     --_nWriters;                                // Decrement number of writers
     _active = -1;                               // Reset active status; block readers
+    ++_stats.writeAcquires;
 }
 
 void ReadWriteLock::rwUnlock ( void )
@@ -39,17 +83,236 @@ void ReadWriteLock::rwUnlock ( void )
     if ( _active > 0 )                          // IF: Readers are active?
     {
         --_active;                              // Decrement a reader active status
-        if ( _active == 0 )                     // IF: There's no reader?
+        if ( _active == 0 && _nWriters > 0 )    // IF: There's no reader?
             _wCondVar.notify_one();             //     Notify a writer to write
     }
     else                                        // ELSE: readers are not active
     {
         _active = 0;                            // Reset active status
-        if ( _nWriters > 0 )                    // IF: There are writers?
-            _wCondVar.notify_one();             //     Notify a writer to write
-        else if ( _nReaders > 0 )               // IF: There are readers?
+        if ( _policy == Policy::PHASE_FAIR )    // IF: Phase fair?
+        {
+            _grantTicket = _nextTicket;         //     Readers waiting now go before
+            _nGranted    = _nReaders;           //     the next writer
+        }
+
+        const bool isReaderFirst =              // Readers go first unless writers
+            ( _policy == Policy::WRITER_PREFERRING ) ? ( _nWriters == 0 ) : ( _nReaders > 0 );
+
+        if ( isReaderFirst && _nReaders > 0 )   // IF: Readers go first?
             _rCondVar.notify_all();             //     Notify all readers to read
+        else if ( _nWriters > 0 )               // IF: There are writers?
+            _wCondVar.notify_one();             //     Notify a writer to write
     }
 }
 
+void ReadWriteLock::setPolicy( const Policy policy )
+{
+    lock_guard< mutex > lock( _mutex );
+    _policy      = policy;
+    _grantTicket = _nextTicket;
+    _nGranted    = 0;
+
+    /* Let waiters re-evaluate their conditions under the new policy */
+    _rCondVar.notify_all();
+    _wCondVar.notify_all();
+}
+
+ReadWriteLock::Policy ReadWriteLock::policy( void ) const
+{
+    lock_guard< mutex > lock( _mutex );
+    return _policy;
+}
+
+ReadWriteLock::Stats ReadWriteLock::stats( void ) const
+{
+    lock_guard< mutex > lock( _mutex );
+    return _stats;
+}
+
+void ReadWriteLock::resetStats( void )
+{
+    lock_guard< mutex > lock( _mutex );
+    _stats = Stats{};
+}
+
+bool ReadWriteLock::isReaderBlocked( const uint64_t ticket ) const
+{
+    if ( _active < 0 ) return true;             // Writer is active
+
+    switch ( _policy )
+    {
+        case Policy::READER_PREFERRING:
+            return false;
+
+        case Policy::WRITER_PREFERRING:
+            return ( _nWriters > 0 );
+
+        case Policy::PHASE_FAIR:
+            return ( _nWriters > 0 && ticket >= _grantTicket );
+    }
+
+    return false;
+}
+
+bool ReadWriteLock::isWriterBlocked( void ) const
+{
+    if ( _active != 0 ) return true;            // Readers or a writer active
+
+    switch ( _policy )
+    {
+        case Policy::READER_PREFERRING:
+            return ( _nReaders > 0 );
+
+        case Policy::WRITER_PREFERRING:
+            return false;
+
+        case Policy::PHASE_FAIR:
+            return ( _nGranted > 0 );
+    }
+
+    return false;
+}
+
+ScalableReadWriteLock::ScalableReadWriteLock( const Policy policy ) :
+    _writer{ false }, _owner{ std::thread::id() }, _nWriters{ 0 }, _stats{}
+{
+    ( void ) policy;
+
+    for ( auto& slot : _slots )
+    {
+        slot.count    = 0;
+        slot.acquires = 0;
+        slot.waits    = 0;
+        slot.waitNs   = 0;
+    }
+}
+
+void ScalableReadWriteLock::readLock( void )
+{
+    ReaderSlot& slot = _slots[ slotIndex() ];
+
+    /* Announce reader, then check for writer; pairs with writeLock */
+    slot.count.fetch_add( 1 );
+    if ( _writer.load() )
+    {
+        const auto start = steady_clock::now();
+
+        do
+        {
+            /* Back off so the writer can drain, wait until it's done */
+            slot.count.fetch_sub( 1, memory_order_release );
+            {
+                lock_guard< mutex > wait( _writerMutex );
+            }
+            slot.count.fetch_add( 1 );
+        }
+        while ( _writer.load() );
+
+        slot.waits.fetch_add( 1, memory_order_relaxed );
+        slot.waitNs.fetch_add( duration_cast< nanoseconds >( steady_clock::now() - start ).count(),
+                               memory_order_relaxed );
+    }
+
+    slot.acquires.fetch_add( 1, memory_order_relaxed );
+}
+
+void ScalableReadWriteLock::writeLock( void )
+{
+    const auto start = steady_clock::now();
+
+    /* Serialize writers */
+    ++_nWriters;
+    _writerMutex.lock();
+    const size_t queue = _nWriters--;
+
+    /* Raise the flag, then wait for readers to drain; pairs with readLock */
+    _writer.store( true );
+
+    bool isWaiting = ( queue > 1 );
+    for ( auto& slot : _slots )
+    {
+        while ( slot.count.load() != 0 )
+        {
+            isWaiting = true;
+            std::this_thread::yield();
+        }
+    }
+
+    _owner.store( std::this_thread::get_id(), memory_order_relaxed );
+
+    ++_stats.writeAcquires;
+    if ( isWaiting )
+    {
+        ++_stats.writeWaits;
+        _stats.writeWaitNs  += duration_cast< nanoseconds >( steady_clock::now() - start ).count();
+        _stats.maxWriteQueue = max< uint64_t >( _stats.maxWriteQueue, queue );
+    }
+}
+
+void ScalableReadWriteLock::rwUnlock( void )
+{
+    /* Only the writer finds its own id; readers never store it */
+    if ( _owner.load( memory_order_relaxed ) == std::this_thread::get_id() )
+    {
+        _owner.store( std::thread::id(), memory_order_relaxed );
+        _writer.store( false, memory_order_release );
+        _writerMutex.unlock();
+    }
+    else
+    {
+        _slots[ slotIndex() ].count.fetch_sub( 1, memory_order_release );
+    }
+}
+
+void ScalableReadWriteLock::setPolicy( const Policy policy )
+{
+    ( void ) policy;
+}
+
+ScalableReadWriteLock::Policy ScalableReadWriteLock::policy( void ) const
+{
+    return Policy::WRITER_PREFERRING;
+}
+
+ScalableReadWriteLock::Stats ScalableReadWriteLock::stats( void ) const
+{
+    Stats stats{};
+    {
+        lock_guard< mutex > lock( _writerMutex );
+        stats = _stats;
+    }
+
+    for ( const auto& slot : _slots )
+    {
+        stats.readAcquires += slot.acquires.load( memory_order_relaxed );
+        stats.readWaits    += slot.waits.load( memory_order_relaxed );
+        stats.readWaitNs   += slot.waitNs.load( memory_order_relaxed );
+    }
+
+    return stats;
+}
+
+void ScalableReadWriteLock::resetStats( void )
+{
+    {
+        lock_guard< mutex > lock( _writerMutex );
+        _stats = Stats{};
+    }
+
+    for ( auto& slot : _slots )
+    {
+        slot.acquires.store( 0, memory_order_relaxed );
+        slot.waits.store( 0, memory_order_relaxed );
+        slot.waitNs.store( 0, memory_order_relaxed );
+    }
+}
+
+size_t ScalableReadWriteLock::slotIndex( void )
+{
+    static std::atomic< size_t > nextSlot{ 0 };
+    static thread_local const size_t slot = nextSlot++ % READER_SLOTS;
+
+    return slot;
+}
+
 } // HashMapTest
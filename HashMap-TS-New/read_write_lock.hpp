@@ -2,6 +2,9 @@
 #define READ_WRITE_LOCK_HPP_
 
 #include <mutex>
+#include <atomic>
+#include <thread>
+#include <cstdint>
 #include <condition_variable>
 
 
@@ -10,22 +13,125 @@ namespace HashMapTest {
 using std::mutex;
 using std::condition_variable;
 
+const unsigned int READER_SLOTS        = 64;    // reader counters per scalable lock
+const unsigned int READER_SLOT_PADDING = 64;    // cache line size
+
+/*
+ * Policies decide who goes first when both readers and writers wait:
+ *
+ *  READER_PREFERRING - readers never wait for waiting writers; writers
+ *                      wait until no reader is active or waiting.
+ *  WRITER_PREFERRING - a waiting writer blocks new readers (default).
+ *  PHASE_FAIR        - a waiting writer blocks new readers, but when a
+ *                      writer releases, all readers that arrived before
+ *                      enter ahead of the next writer; read and write
+ *                      phases alternate, so neither side starves.
+ *
+ * Counters are kept under the internal mutex that is taken anyway; wait
+ * times are only measured for acquisitions that actually wait.
+ */
 class ReadWriteLock
 {
 public:
-    ReadWriteLock();
+    enum class Policy : unsigned int { READER_PREFERRING, WRITER_PREFERRING, PHASE_FAIR };
+
+    struct Stats
+    {
+        uint64_t    readAcquires;       // read locks taken
+        uint64_t    writeAcquires;      // write locks taken
+        uint64_t    readWaits;          // read locks that had to wait
+        uint64_t    writeWaits;         // write locks that had to wait
+        uint64_t    readWaitNs;         // total time readers waited
+        uint64_t    writeWaitNs;        // total time writers waited
+        uint64_t    maxReadQueue;       // most readers waiting at once
+        uint64_t    maxWriteQueue;      // most writers waiting at once
+
+        Stats& operator+=( const Stats& other );
+    };
+
+    ReadWriteLock( const Policy policy = Policy::WRITER_PREFERRING );
 
     void readLock ( void );
     void writeLock( void );
     void rwUnlock ( void );
 
+    void   setPolicy( const Policy policy );
+    Policy policy   ( void ) const;
+
+    Stats stats     ( void ) const;
+    void  resetStats( void );
+
 private:
-    mutex                   _mutex;         // common mutex for unique_lock
+    bool isReaderBlocked( const uint64_t ticket ) const;
+    bool isWriterBlocked( void ) const;
+
+    mutable mutex           _mutex;         // common mutex for unique_lock
     condition_variable      _rCondVar;      // condition variable for readers
     condition_variable      _wCondVar;      // condition variable for writers
     size_t                  _nReaders;      // count for readers
     size_t                  _nWriters;      // count for writers
     int                     _active;        // flag to avoid spurious wake-ups
+    Policy                  _policy;        // who goes first
+    uint64_t                _nextTicket;    // arrival order of readers
+    uint64_t                _grantTicket;   // readers arrived before may pass waiting writers
+    size_t                  _nGranted;      // granted readers yet to enter
+    Stats                   _stats;         // fairness counters
+};
+
+/*
+ * Read-mostly lock with the interface of ReadWriteLock. Every thread counts
+ * its read locks in its own slot, padded to a cache line, so readers that
+ * don't meet a writer never write to a shared line. A writer raises a flag
+ * and waits for all slots to drain; readers that see the flag back off and
+ * block on the writer mutex until the writer is done.
+ *
+ * Slots are handed out to threads in round robin, so up to READER_SLOTS
+ * threads get a slot of their own; more threads share slots. Writers are
+ * always preferred; setPolicy is accepted for interface compatibility but
+ * has no effect. Read acquisitions are counted per slot; read waits are
+ * only counted for readers that backed off, and read queues are not
+ * tracked.
+ */
+class ScalableReadWriteLock
+{
+public:
+    typedef ReadWriteLock::Policy Policy;
+    typedef ReadWriteLock::Stats  Stats;
+
+    ScalableReadWriteLock( const Policy policy = Policy::WRITER_PREFERRING );
+
+    ScalableReadWriteLock( const ScalableReadWriteLock& ) = delete;
+    ScalableReadWriteLock& operator=( const ScalableReadWriteLock& ) = delete;
+
+    void readLock ( void );
+    void writeLock( void );
+    void rwUnlock ( void );
+
+    void   setPolicy( const Policy policy );
+    Policy policy   ( void ) const;
+
+    Stats stats     ( void ) const;
+    void  resetStats( void );
+
+private:
+    /* Padded so that neighbouring slots don't share a cache line */
+    struct ReaderSlot
+    {
+        std::atomic< size_t >   count;          // read locks held through this slot
+        std::atomic< uint64_t > acquires;       // read locks taken
+        std::atomic< uint64_t > waits;          // readers that backed off
+        std::atomic< uint64_t > waitNs;         // time readers backed off
+        char                    padding[ READER_SLOT_PADDING ];
+    };
+
+    static size_t slotIndex( void );
+
+    ReaderSlot                          _slots[ READER_SLOTS ];
+    mutable mutex                       _writerMutex;   // serializes writers; readers wait on it
+    std::atomic< bool >                 _writer;        // writer active or draining readers
+    std::atomic< std::thread::id >      _owner;         // thread holding the write lock
+    std::atomic< size_t >               _nWriters;      // writers waiting for _writerMutex
+    Stats                               _stats;         // writer counters; under _writerMutex
 };
 
 } // HashMapTest
@@ -0,0 +1,358 @@
+#ifndef SHARDED_HASHMAP_HPP_
+#define SHARDED_HASHMAP_HPP_
+
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include "logger.hpp"
+#include "hashmap.hpp"
+#include "numa_topology.hpp"
+
+
+namespace HashMapTest {
+
+/* Shards per hardware thread when the shard count is left to the map */
+const unsigned int SHARDS_PER_THREAD = 1;
+
+/*
+ * Independent TSHashMaps behind one interface. A key is hashed once; the
+ * highest bits of its hash pick the shard and the hash is passed on to
+ * it, whose stripes and buckets use the lowest bits, so keys of a shard
+ * still spread over all of its stripes and buckets.
+ *
+ * Every shard has its own table, stripes, allocator and reclaimer, and
+ * grows and shrinks on its own: a resize only ever takes the stripes of
+ * one shard, and the others keep going. Initial size is split evenly
+ * among the shards.
+ *
+ * With shards 0, the shard count follows std::thread::hardware_concurrency()
+ * (SHARDS_PER_THREAD each); the count is rounded up to a power of two.
+ * length, size, lockStats, stats and opStats add up all shards (maxChain is the
+ * longest of them); print prints them one by one, so it's not a snapshot
+ * of the whole map.
+ *
+ * placeOnNodes deals shards to NUMA nodes in round robin and places each
+ * shard's table and entries on its node. Keys are routed by hash, so a
+ * thread can't pick its shard; it can prefer keys of shards on its own
+ * node, though (isLocal, localShards), e.g. when partitioning work.
+ */
+template < typename K, typename V, typename F = DefaultHashFunction< K >, typename A = PoolAllocator< Entry< K, V > >,
+           typename L = ReadWriteLock >
+class ShardedHashMap
+{
+public:
+    typedef TSHashMap< K, V, F, A, L > Shard;
+
+    ShardedHashMap( const size_t size,
+                    const size_t shards          = 0,
+                    const size_t stripes         = DEFAULT_LOCK_STRIPES,
+                    const float  maxLoadFactor   = DEFAULT_MAX_LOAD_FACTOR,
+                    const float  minLoadFactor   = DEFAULT_MIN_LOAD_FACTOR,
+                    const bool   optimisticReads = false );
+
+    ~ShardedHashMap();
+
+    ShardedHashMap( const ShardedHashMap& ) = delete;
+    ShardedHashMap& operator=( const ShardedHashMap& ) = delete;
+
+    bool add ( const K& key, const V& value );
+    bool add ( const K& key, V&& value );
+    bool del ( const K& key );
+    bool find( const K& key, V& value );
+
+    template < typename Visitor >
+    bool visit( const K& key, Visitor&& visitor );
+
+    const size_t size  ( void ) const;
+    const size_t length( void ) const;
+    const size_t shards( void ) const;
+
+    const float loadFactor( void ) const;
+
+    Shard& shard  ( const size_t index );
+    size_t shardOf( const K& key ) const;
+
+    void                 setLockPolicy ( const typename L::Policy policy );
+    typename L::Stats    lockStats     ( void ) const;
+    void                 resetLockStats( void );
+
+    typename Shard::Stats stats( void ) const;
+
+    OpStats::Snapshot opStats     ( void ) const;
+    void              resetOpStats( void );
+
+    void print( void );
+
+    void                  placeOnNodes( void );
+    int                   nodeOf      ( const size_t index ) const;
+    bool                  isLocal     ( const K& key ) const;
+    std::vector< size_t > localShards ( void ) const;
+
+    static size_t defaultShards( void );
+
+private:
+    size_t shardOfHash( const HashType hash ) const;
+
+    F               _hashFunction;
+    Shard**         _shards;
+    size_t          _nShards;
+    unsigned int    _shardShift;    // hash bits below the shard index
+};
+
+template < typename K, typename V, typename F, typename A, typename L >
+ShardedHashMap<K, V, F, A, L>::ShardedHashMap( const size_t size,
+                                               const size_t shards,
+                                               const size_t stripes,
+                                               const float  maxLoadFactor,
+                                               const float  minLoadFactor,
+                                               const bool   optimisticReads ) :
+    _shards{ nullptr }, _nShards{ shards }, _shardShift{ 0 }
+{
+    /* Validate positive number of shards; follow hardware threads otherwise */
+    if ( shards <= 0 )
+    {
+        _nShards = defaultShards();
+    }
+
+    _nShards = roundUpToPowerOfTwo( _nShards );
+
+    /* Shard index is in the highest bits of the hash */
+    unsigned int shardBits = 0;
+    while ( ( (size_t) 1 << shardBits ) < _nShards ) ++shardBits;
+
+    _shardShift = sizeof( HashType ) * 8 - shardBits;
+
+    /* Allocate shards; each gets an even part of the size */
+    _shards = new Shard*[ _nShards ];
+
+    for ( size_t i = 0; i < _nShards; ++i )
+    {
+        _shards[ i ] = new Shard( std::max< size_t >( size / _nShards, 1 ), stripes,
+                                  maxLoadFactor, minLoadFactor, optimisticReads );
+    }
+
+    LOG_INF() << "Sharded HashMap created! Shards: " << _nShards << ", Size: " << this->size() << endl;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+ShardedHashMap<K, V, F, A, L>::~ShardedHashMap()
+{
+    LOG_INF() << "Deleting Sharded HashMap (" << length() << ")..." << endl;
+
+    for ( size_t i = 0; i < _nShards; ++i ) delete _shards[ i ];
+
+    delete[] _shards;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+bool ShardedHashMap<K, V, F, A, L>::add( const K& key, const V& value )
+{
+    const HashType hash = _hashFunction( key );
+
+    return _shards[ shardOfHash( hash ) ]->add( key, value, hash );
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+bool ShardedHashMap<K, V, F, A, L>::add( const K& key, V&& value )
+{
+    const HashType hash = _hashFunction( key );
+
+    return _shards[ shardOfHash( hash ) ]->add( key, std::move( value ), hash );
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+bool ShardedHashMap<K, V, F, A, L>::del( const K& key )
+{
+    const HashType hash = _hashFunction( key );
+
+    return _shards[ shardOfHash( hash ) ]->del( key, hash );
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+bool ShardedHashMap<K, V, F, A, L>::find( const K& key, V& value )
+{
+    const HashType hash = _hashFunction( key );
+
+    return _shards[ shardOfHash( hash ) ]->find( key, value, hash );
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+template < typename Visitor >
+bool ShardedHashMap<K, V, F, A, L>::visit( const K& key, Visitor&& visitor )
+{
+    const HashType hash = _hashFunction( key );
+
+    return _shards[ shardOfHash( hash ) ]->visit( key, std::forward< Visitor >( visitor ), hash );
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+const size_t ShardedHashMap<K, V, F, A, L>::size( void ) const
+{
+    size_t size = 0;
+
+    for ( size_t i = 0; i < _nShards; ++i ) size += _shards[ i ]->size();
+
+    return size;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+const size_t ShardedHashMap<K, V, F, A, L>::length( void ) const
+{
+    size_t length = 0;
+
+    for ( size_t i = 0; i < _nShards; ++i ) length += _shards[ i ]->length();
+
+    return length;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+const size_t ShardedHashMap<K, V, F, A, L>::shards( void ) const
+{
+    return _nShards;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+const float ShardedHashMap<K, V, F, A, L>::loadFactor( void ) const
+{
+    return ( (float) length() / size() );
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+typename ShardedHashMap<K, V, F, A, L>::Shard& ShardedHashMap<K, V, F, A, L>::shard( const size_t index )
+{
+    return *_shards[ index ];
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+size_t ShardedHashMap<K, V, F, A, L>::shardOf( const K& key ) const
+{
+    return shardOfHash( _hashFunction( key ) );
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+void ShardedHashMap<K, V, F, A, L>::setLockPolicy( const typename L::Policy policy )
+{
+    for ( size_t i = 0; i < _nShards; ++i ) _shards[ i ]->setLockPolicy( policy );
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+typename L::Stats ShardedHashMap<K, V, F, A, L>::lockStats( void ) const
+{
+    typename L::Stats stats{};
+
+    for ( size_t i = 0; i < _nShards; ++i ) stats += _shards[ i ]->lockStats();
+
+    return stats;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+void ShardedHashMap<K, V, F, A, L>::resetLockStats( void )
+{
+    for ( size_t i = 0; i < _nShards; ++i ) _shards[ i ]->resetLockStats();
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+typename ShardedHashMap<K, V, F, A, L>::Shard::Stats ShardedHashMap<K, V, F, A, L>::stats( void ) const
+{
+    typename Shard::Stats stats{};
+
+    for ( size_t i = 0; i < _nShards; ++i )
+    {
+        const typename Shard::Stats shardStats = _shards[ i ]->stats();
+
+        stats.length   += shardStats.length;
+        stats.size     += shardStats.size;
+        stats.occupied += shardStats.occupied;
+        stats.maxChain  = std::max( stats.maxChain, shardStats.maxChain );
+    }
+
+    return stats;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+OpStats::Snapshot ShardedHashMap<K, V, F, A, L>::opStats( void ) const
+{
+    OpStats::Snapshot snapshot{};
+
+    for ( size_t i = 0; i < _nShards; ++i ) snapshot += _shards[ i ]->opStats();
+
+    return snapshot;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+void ShardedHashMap<K, V, F, A, L>::resetOpStats( void )
+{
+    for ( size_t i = 0; i < _nShards; ++i ) _shards[ i ]->resetOpStats();
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+void ShardedHashMap<K, V, F, A, L>::print( void )
+{
+    /* Print length of hash map */
+    LOG_INF() << "Sharded HashMap Length: " << length() << ", Shards: " << _nShards << endl;
+
+    for ( size_t i = 0; i < _nShards; ++i )
+    {
+        LOG_INF() << "Shard No: " << ( i + 1 ) << endl;
+
+        _shards[ i ]->print();
+    }
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+void ShardedHashMap<K, V, F, A, L>::placeOnNodes( void )
+{
+    const size_t nodes = NumaTopology::nodes();
+
+    for ( size_t i = 0; i < _nShards; ++i ) _shards[ i ]->setNode( (int) ( i % nodes ) );
+
+    LOG_INF() << "Placed " << _nShards << " shards on " << nodes << " nodes"
+              << ( NumaTopology::isSimulated() ? " (simulated)" : "" ) << endl;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+int ShardedHashMap<K, V, F, A, L>::nodeOf( const size_t index ) const
+{
+    return _shards[ index ]->node();
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+bool ShardedHashMap<K, V, F, A, L>::isLocal( const K& key ) const
+{
+    return ( nodeOf( shardOf( key ) ) == NumaTopology::currentNode() );
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+std::vector< size_t > ShardedHashMap<K, V, F, A, L>::localShards( void ) const
+{
+    const int             node = NumaTopology::currentNode();
+    std::vector< size_t > shards;
+
+    for ( size_t i = 0; i < _nShards; ++i )
+    {
+        if ( nodeOf( i ) == node ) shards.push_back( i );
+    }
+
+    return shards;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+size_t ShardedHashMap<K, V, F, A, L>::defaultShards( void )
+{
+    const size_t threads = std::thread::hardware_concurrency();
+
+    /* Unknown concurrency; a single shard */
+    return ( threads > 0 ) ? threads * SHARDS_PER_THREAD : 1;
+}
+
+template < typename K, typename V, typename F, typename A, typename L >
+size_t ShardedHashMap<K, V, F, A, L>::shardOfHash( const HashType hash ) const
+{
+    /* Shifting by the full width is undefined; a single shard takes all */
+    return ( _nShards > 1 ) ? (size_t) ( hash >> _shardShift ) : 0;
+}
+
+} // HashMapTest
+
+
+#endif /* SHARDED_HASHMAP_HPP_ */
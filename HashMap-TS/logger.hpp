@@ -9,12 +9,16 @@ using std::string;
 using std::ostream;
 using std::mutex;
 
-/* Global stream lock */
-mutex globalStreamLock;
+/* Stream lock; one instance however many files include this header */
+inline mutex& globalStreamLock( void )
+{
+    static mutex streamLock;
+    return streamLock;
+}
 
 /* Global stream lock macros */
-#define LOCK_STREAM()       globalStreamLock.lock()
-#define UNLOCK_STREAM()     globalStreamLock.unlock()
+#define LOCK_STREAM()       globalStreamLock().lock()
+#define UNLOCK_STREAM()     globalStreamLock().unlock()
 
 /* Logging Macros */
 #define LOG_INF() \
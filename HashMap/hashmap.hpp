@@ -2,21 +2,33 @@
 #define HASHMAP_HPP_
 
 #include <mutex>
+#include <algorithm>
 #include "logger.hpp"
 
 namespace HashMapTest {
 
-const unsigned int DEFAULT_SIZE = 10;
+const unsigned int DEFAULT_SIZE            = 16;
+const float        DEFAULT_MAX_LOAD_FACTOR = 0.75f;
+const float        DEFAULT_MIN_LOAD_FACTOR = 0.125f;
 
 typedef unsigned int HashType;
 
+/* Round up to the next power of two; sizes are always powers of two */
+inline size_t roundUpToPowerOfTwo( const size_t n )
+{
+    size_t power = 1;
+    while ( power < n ) power <<= 1;
+    return power;
+}
+
+/* Size is always a power of two, so a mask replaces the modulo */
 template < typename K >
 class DefaultHashFunction
 {
 public:
     HashType operator()( const K& key, const size_t size ) const
     {
-        return ( (HashType) key % size );
+        return ( (HashType) key & ( size - 1 ) );
     }
 };
 
@@ -49,11 +61,18 @@ private:
     Entry*  _next;
 };
 
+/*
+ * The table doubles when length exceeds size * maxLoadFactor, and halves
+ * (but never below its initial size) when length drops under
+ * size * minLoadFactor. A minLoadFactor of 0 disables shrinking.
+ */
 template < typename K, typename V, typename F = DefaultHashFunction< K > >
 class TSHashMap
 {
 public:
-    TSHashMap( const size_t size );
+    TSHashMap( const size_t size,
+               const float  maxLoadFactor = DEFAULT_MAX_LOAD_FACTOR,
+               const float  minLoadFactor = DEFAULT_MIN_LOAD_FACTOR );
 
     ~TSHashMap();
 
@@ -64,20 +83,32 @@ public:
     const size_t size  ( void ) const;
     const size_t length( void ) const;
 
+    const float loadFactor   ( void ) const;
+    const float maxLoadFactor( void ) const;
+    const float minLoadFactor( void ) const;
+
     bool resize( const size_t size );
 
     void print( void );
 
 private:
+    bool rehash    ( const size_t size );
+    void autoResize( void );
+
     Entry<K, V>**   _hashTable;
     F               _hashFunction;
     size_t          _size;
+    size_t          _minSize;
     size_t          _length;
+    float           _maxLoadFactor;
+    float           _minLoadFactor;
     std::mutex      _mutex;
 };
 
 template < typename K, typename V, typename F >
-TSHashMap<K, V, F>::TSHashMap( const size_t size ) : _hashTable{ nullptr }, _size{ size }, _length{ 0 }
+TSHashMap<K, V, F>::TSHashMap( const size_t size, const float maxLoadFactor, const float minLoadFactor ) :
+    _hashTable{ nullptr }, _size{ size }, _minSize{ 0 }, _length{ 0 },
+    _maxLoadFactor{ maxLoadFactor }, _minLoadFactor{ minLoadFactor }
 {
     /* Validate positive size; use default size otherwise */
     if ( size <= 0 )
@@ -85,6 +116,22 @@ TSHashMap<K, V, F>::TSHashMap( const size_t size ) : _hashTable{ nullptr }, _siz
         _size = DEFAULT_SIZE;
     }
 
+    /* Validate positive max load factor; use default otherwise */
+    if ( maxLoadFactor <= 0 )
+    {
+        _maxLoadFactor = DEFAULT_MAX_LOAD_FACTOR;
+    }
+
+    /* Keep shrink threshold well below growth threshold to avoid thrashing */
+    if ( minLoadFactor < 0 || minLoadFactor > _maxLoadFactor / 4 )
+    {
+        _minLoadFactor = _maxLoadFactor / 4;
+    }
+
+    /* Round size up to a power of two */
+    _size    = roundUpToPowerOfTwo( _size );
+    _minSize = _size;
+
     /* Initialize hash table / buckets */
     _hashTable = new Entry<K, V>*[ _size ]{};
     if ( _hashTable == nullptr )
@@ -97,7 +144,7 @@ TSHashMap<K, V, F>::TSHashMap( const size_t size ) : _hashTable{ nullptr }, _siz
     }
 
     LOCK_STREAM();
-    LOG_INF() << "HashMap created! Size: " << size << endl;
+    LOG_INF() << "HashMap created! Size: " << _size << endl;
     UNLOCK_STREAM();
 }
 
@@ -187,6 +234,12 @@ bool TSHashMap<K, V, F>::add ( const K& key, const V& value )
             /* Add another entry in the chain */
             tmpEntry->setNext( newEntry );
         }
+
+        /* Increment length of hash map */
+        _length++;
+
+        /* Grow table if max load factor is exceeded */
+        autoResize();
     }
     else
     {
@@ -194,9 +247,6 @@ bool TSHashMap<K, V, F>::add ( const K& key, const V& value )
         newEntry->setValue( value );
     }
 
-    /* Increment length of hash map */
-    _length++;
-
     _mutex.unlock();
 
     return true;
@@ -248,6 +298,9 @@ bool TSHashMap<K, V, F>::del ( const K& key )
     /* Decrement length of hash map */
     _length--;
 
+    /* Shrink table if length dropped below min load factor */
+    autoResize();
+
     _mutex.unlock();
 
     return true;
@@ -296,10 +349,49 @@ const size_t TSHashMap<K, V, F>::length( void ) const
     return _length;
 }
 
+template < typename K, typename V, typename F >
+const float TSHashMap<K, V, F>::loadFactor( void ) const
+{
+    return ( (float) _length / _size );
+}
+
+template < typename K, typename V, typename F >
+const float TSHashMap<K, V, F>::maxLoadFactor( void ) const
+{
+    return _maxLoadFactor;
+}
+
+template < typename K, typename V, typename F >
+const float TSHashMap<K, V, F>::minLoadFactor( void ) const
+{
+    return _minLoadFactor;
+}
+
 template < typename K, typename V, typename F >
 bool TSHashMap<K, V, F>::resize( const size_t size )
 {
-    return true;
+    /* Round new size up to a power of two */
+    const size_t newSize = roundUpToPowerOfTwo( std::max< size_t >( size, 1 ) );
+
+    _mutex.lock();
+
+    /* Validate new size; should differ from old size */
+    if ( newSize == _size )
+    {
+        _mutex.unlock();
+
+        LOCK_STREAM();
+        LOG_ERR() << "Cannot resize! New size must differ from old size!" << endl;
+        UNLOCK_STREAM();
+
+        return false;
+    }
+
+    const bool isResized = rehash( newSize );
+
+    _mutex.unlock();
+
+    return isResized;
 }
 
 template < typename K, typename V, typename F >
@@ -335,6 +427,70 @@ void TSHashMap<K, V, F>::print( void )
     _mutex.unlock();
 }
 
+template < typename K, typename V, typename F >
+bool TSHashMap<K, V, F>::rehash( const size_t size )
+{
+    /* Caller must hold the mutex */
+
+    /* Allocate memory for new HashMap table */
+    auto newHashTable = new Entry<K, V>*[ size ]{};
+    if ( newHashTable == nullptr )
+    {
+        LOCK_STREAM();
+        LOG_ERR() << "Could not allocate memory for resizing! Returning..." << endl;
+        UNLOCK_STREAM();
+
+        return false;
+    }
+
+    /* Relink entries from old to new HashMap table */
+    for ( size_t i = 0; i < _size; ++i )
+    {
+        Entry<K, V>* thisEntry = _hashTable[ i ];
+
+        while ( thisEntry != nullptr )
+        {
+            Entry<K, V>* nextEntry = thisEntry->getNext();
+
+            /* Push entry to the front of its new bucket */
+            const HashType hash = _hashFunction( thisEntry->getKey(), size );
+            thisEntry->setNext( newHashTable[ hash ] );
+            newHashTable[ hash ] = thisEntry;
+
+            thisEntry = nextEntry;
+        }
+    }
+
+    LOCK_STREAM();
+    LOG_INF() << "Resized from " << _size << " to " << size << endl;
+    UNLOCK_STREAM();
+
+    /* Delete old HashMap table */
+    delete [] _hashTable;
+
+    _hashTable = newHashTable;
+    _size      = size;
+
+    return true;
+}
+
+template < typename K, typename V, typename F >
+void TSHashMap<K, V, F>::autoResize( void )
+{
+    /* Caller must hold the mutex */
+
+    /* Double the size when too loaded */
+    if ( _length > _size * _maxLoadFactor )
+    {
+        rehash( _size << 1 );
+    }
+    /* Halve the size when too sparse, but not below the initial size */
+    else if ( _size > _minSize && _length < _size * _minLoadFactor )
+    {
+        rehash( _size >> 1 );
+    }
+}
+
 } // HashMapTest
 
 